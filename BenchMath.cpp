@@ -0,0 +1,403 @@
+// Micro-benchmarks for the math primitives. Build and run with `make bench_math`
+// and `./bench_math`. Needs no window or GL context, so it can run headless.
+//
+// Every benchmark works on BENCH_ELEMENTS inputs drawn from a fixed seed, so runs
+// are comparable across builds. Each one is calibrated to take about BENCH_TARGET_MS
+// per repetition, repeated BENCH_REPETITIONS times, and reported as the median,
+// minimum and standard deviation of ns per operation.
+#include "Math.hpp"
+#include "FastMath.hpp"
+#include "Vector4f.hpp"
+#include "Vector3fArray.hpp"
+#include "Quantize.hpp"
+#include "OrientedBoundingBox.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define BENCH_SEED 20121
+#define BENCH_ELEMENTS 4096
+#define BENCH_REPETITIONS 9
+#define BENCH_TARGET_MS 20.0
+// The terrain normals benchmark runs on a square grid of BENCH_ELEMENTS samples
+#define BENCH_GRID_SIZE 64
+
+// Results are added in here, so the compiler can't drop the work
+static volatile float gSink = 0.0f;
+
+/***********************************************************
+ * Harness
+ **********************************************************/
+static double nanosecondsSince( std::chrono::steady_clock::time_point start )
+{
+	return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// body() does BENCH_ELEMENTS operations and returns something derived from their results
+template<typename Body>
+static void runBenchmark( const char * name, Body body )
+{
+	// Warm up the caches, then see how many passes fill the target time
+	gSink = gSink + body();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	gSink = gSink + body();
+	double passNanoseconds = std::max( nanosecondsSince( start ), 1.0 );
+	int passes = std::max( 1, static_cast<int>( BENCH_TARGET_MS * 1e6 / passNanoseconds ) );
+
+	std::vector<double> nanosecondsPerOp;
+	for( int repetition = 0; repetition < BENCH_REPETITIONS; repetition++ )
+	{
+		float sum = 0.0f;
+		start = std::chrono::steady_clock::now();
+		for( int pass = 0; pass < passes; pass++ )
+		{
+			sum += body();
+		}
+		nanosecondsPerOp.push_back( nanosecondsSince( start ) / ( static_cast<double>( passes ) * BENCH_ELEMENTS ) );
+		gSink = gSink + sum;
+	}
+
+	std::sort( nanosecondsPerOp.begin(), nanosecondsPerOp.end() );
+	double mean = 0.0;
+	for( size_t i = 0; i < nanosecondsPerOp.size(); i++ )
+	{
+		mean += nanosecondsPerOp[i];
+	}
+	mean /= nanosecondsPerOp.size();
+	double variance = 0.0;
+	for( size_t i = 0; i < nanosecondsPerOp.size(); i++ )
+	{
+		variance += ( nanosecondsPerOp[i] - mean ) * ( nanosecondsPerOp[i] - mean );
+	}
+	double standardDeviation = sqrt( variance / nanosecondsPerOp.size() );
+
+	printf( "  %-40s %9.3f %9.3f %9.3f\n", name, nanosecondsPerOp[nanosecondsPerOp.size() / 2], nanosecondsPerOp[0], standardDeviation );
+}
+
+static void printSection( const char * title )
+{
+	printf( "\n%s\n  %-40s %9s %9s %9s\n", title, "", "median", "min", "stddev" );
+}
+
+/***********************************************************
+ * Inputs
+ **********************************************************/
+static std::mt19937 gRandom( BENCH_SEED );
+
+static float randomFloat( float low, float high )
+{
+	return std::uniform_real_distribution<float>( low, high )( gRandom );
+}
+
+static Vector3f randomVector( float range )
+{
+	return Vector3f( randomFloat( -range, range ), randomFloat( -range, range ), randomFloat( -range, range ) );
+}
+
+static Quaternion randomQuaternion()
+{
+	return Quaternion( randomVector( 1.0f ), randomFloat( -180.0f, 180.0f ) );
+}
+
+struct Inputs
+{
+	Vector3f   vectorsA[BENCH_ELEMENTS];
+	Vector3f   vectorsB[BENCH_ELEMENTS];
+	Vector3f   vectorsOut[BENCH_ELEMENTS];
+	Vector4f   vectors4A[BENCH_ELEMENTS];
+	Vector4f   vectors4B[BENCH_ELEMENTS];
+	Vector4f   vectors4Out[BENCH_ELEMENTS];
+	Quaternion quaternionsA[BENCH_ELEMENTS];
+	Quaternion quaternionsB[BENCH_ELEMENTS];
+	Quaternion quaternionsOut[BENCH_ELEMENTS];
+	float      radii[BENCH_ELEMENTS];
+	float      angles[BENCH_ELEMENTS];
+	float      positives[BENCH_ELEMENTS];
+	float      floatsOut[BENCH_ELEMENTS];
+	Frustum::Classification classifications[BENCH_ELEMENTS];
+	PackedNormal      packedNormals[BENCH_ELEMENTS];
+	QuantizedPosition quantizedPositions[BENCH_ELEMENTS];
+	PackedQuaternion  packedQuaternions[BENCH_ELEMENTS];
+};
+
+static void fillInputs( Inputs & inputs, Vector3fArray & arrayA, Vector3fArray & arrayB, Vector3fArray & arrayOut )
+{
+	for( int i = 0; i < BENCH_ELEMENTS; i++ )
+	{
+		inputs.vectorsA[i] = randomVector( 100.0f );
+		inputs.vectorsB[i] = randomVector( 100.0f );
+		inputs.vectors4A[i] = Vector4f( inputs.vectorsA[i] );
+		inputs.vectors4B[i] = Vector4f( inputs.vectorsB[i] );
+		inputs.quaternionsA[i] = randomQuaternion();
+		inputs.quaternionsB[i] = randomQuaternion();
+		inputs.radii[i] = randomFloat( 0.0f, 10.0f );
+		inputs.angles[i] = randomFloat( -FAST_MATH_PI, FAST_MATH_PI );
+		inputs.positives[i] = randomFloat( 0.001f, 1000.0f );
+		arrayA.set( i, inputs.vectorsA[i] );
+		arrayB.set( i, inputs.vectorsB[i] );
+	}
+	arrayOut.resize( BENCH_ELEMENTS );
+}
+
+/***********************************************************
+ * Workloads, written once for both Vector3f and Vector4f
+ **********************************************************/
+// Terrain::computeNormals() as it was before it moved to Vector3fArray: the normalized
+// cross products of the triangles around each sample, then smoothed with the neighbors
+template<typename Vector>
+static float computeGridNormals( const float * heights, Vector * faceNormals, Vector * normals )
+{
+	const int size = BENCH_GRID_SIZE;
+	for( int x = 0; x < size; x++ )
+	{
+		for( int z = 0; z < size; z++ )
+		{
+			float height = heights[x * size + z];
+			Vector left = x > 0 ? Vector( -1.0f, heights[( x - 1 ) * size + z] - height, 0.0f ) : Vector();
+			Vector right = x < size - 1 ? Vector( 1.0f, heights[( x + 1 ) * size + z] - height, 0.0f ) : Vector();
+			Vector out = z > 0 ? Vector( 0.0f, heights[x * size + z - 1] - height, -1.0f ) : Vector();
+			Vector in = z < size - 1 ? Vector( 0.0f, heights[x * size + z + 1] - height, 1.0f ) : Vector();
+
+			Vector sum;
+			if( x > 0 && z > 0 )               sum += out.cross( left ).normalize();
+			if( x > 0 && z < size - 1 )        sum += left.cross( in ).normalize();
+			if( x < size - 1 && z < size - 1 ) sum += in.cross( right ).normalize();
+			if( x < size - 1 && z > 0 )        sum += right.cross( out ).normalize();
+			faceNormals[x * size + z] = sum;
+		}
+	}
+
+	for( int x = 0; x < size; x++ )
+	{
+		for( int z = 0; z < size; z++ )
+		{
+			Vector sum = faceNormals[x * size + z];
+			if( x > 0 )        sum += faceNormals[( x - 1 ) * size + z] * 0.5f;
+			if( x < size - 1 ) sum += faceNormals[( x + 1 ) * size + z] * 0.5f;
+			if( z > 0 )        sum += faceNormals[x * size + z - 1] * 0.5f;
+			if( z < size - 1 ) sum += faceNormals[x * size + z + 1] * 0.5f;
+			normals[x * size + z] = sum.normalize();
+		}
+	}
+	return normals[size * size - 1][1];
+}
+
+// Corners of one box against the six faces of another, the test in
+// OrientedBoundingBox::collisionWith(). True if a face separates them.
+template<typename Vector>
+static bool isSeparatedByFaces( const Vector corners[8], const Vector otherCorners[8], const Vector otherAxes[3] )
+{
+	for( int face = 0; face < 6; face++ )
+	{
+		Vector normal = face < 3 ? -otherAxes[face] : otherAxes[face - 3];
+		float offset = normal.dot( face < 3 ? otherCorners[0] : otherCorners[7] );
+		bool isInFront = true;
+		for( int corner = 0; corner < 8 && isInFront; corner++ )
+		{
+			isInFront = normal.dot( corners[corner] ) >= offset;
+		}
+		if( isInFront )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Corners and axes of BENCH_ELEMENTS boxes, computed up front so only the face tests are timed
+template<typename Vector>
+struct BoxSet
+{
+	Vector corners[BENCH_ELEMENTS][8];
+	Vector axes[BENCH_ELEMENTS][3];
+};
+
+// Each box against the next one; about a quarter of the pairs overlap
+template<typename Vector>
+static float collideBoxes( const BoxSet<Vector> & boxes )
+{
+	float collisions = 0.0f;
+	for( int i = 0; i < BENCH_ELEMENTS; i++ )
+	{
+		int j = ( i + 1 ) % BENCH_ELEMENTS;
+		if( !isSeparatedByFaces( boxes.corners[i], boxes.corners[j], boxes.axes[j] ) &&
+		    !isSeparatedByFaces( boxes.corners[j], boxes.corners[i], boxes.axes[i] ) )
+		{
+			collisions += 1.0f;
+		}
+	}
+	return collisions;
+}
+
+/***********************************************************
+ * Accuracy of FastMath.hpp against libm
+ **********************************************************/
+static void reportFastMathAccuracy()
+{
+	const int samples = 1000000;
+	double sinError = 0.0;
+	double cosError = 0.0;
+	double tanError = 0.0;
+	double inverseSqrtError = 0.0;
+	for( int i = 0; i <= samples; i++ )
+	{
+		float angle = -FAST_MATH_PI + FAST_MATH_TWO_PI * i / samples;
+		sinError = std::max( sinError, fabs( fastSin( angle ) - sin( static_cast<double>( angle ) ) ) );
+		cosError = std::max( cosError, fabs( fastCos( angle ) - cos( static_cast<double>( angle ) ) ) );
+
+		float tanAngle = -1.5f + 3.0f * i / samples;
+		double exactTan = tan( static_cast<double>( tanAngle ) );
+		if( fabs( exactTan ) > 1e-3 )
+		{
+			tanError = std::max( tanError, fabs( ( fastTan( tanAngle ) - exactTan ) / exactTan ) );
+		}
+
+		float value = 0.001f + 1000.0f * i / samples;
+		inverseSqrtError = std::max( inverseSqrtError, fabs( fastInverseSqrt( value ) * sqrt( static_cast<double>( value ) ) - 1.0 ) );
+	}
+
+	printf( "\nFastMath accuracy against libm (FAST_MATH_ON = %d)\n", FAST_MATH_ON );
+	printf( "  %-40s %9.3g\n", "fastSin max abs error [-pi, pi]", sinError );
+	printf( "  %-40s %9.3g\n", "fastCos max abs error [-pi, pi]", cosError );
+	printf( "  %-40s %9.3g\n", "fastTan max rel error [-1.5, 1.5]", tanError );
+	printf( "  %-40s %9.3g\n", "fastInverseSqrt max rel error", inverseSqrtError );
+}
+
+int main()
+{
+	static Inputs inputs;
+	Vector3fArray arrayA( BENCH_ELEMENTS );
+	Vector3fArray arrayB( BENCH_ELEMENTS );
+	Vector3fArray arrayOut( BENCH_ELEMENTS );
+	fillInputs( inputs, arrayA, arrayB, arrayOut );
+
+	const Vector3f * a = inputs.vectorsA;
+	const Vector3f * b = inputs.vectorsB;
+	const Vector4f * a4 = inputs.vectors4A;
+	const Vector4f * b4 = inputs.vectors4B;
+	const Quaternion * qa = inputs.quaternionsA;
+	const Quaternion * qb = inputs.quaternionsB;
+	Vector3f * out = inputs.vectorsOut;
+	Vector4f * out4 = inputs.vectors4Out;
+	Quaternion * qOut = inputs.quaternionsOut;
+	float * floatsOut = inputs.floatsOut;
+
+	printf( "bench_math: %d elements, %d repetitions, seed %d, ns per operation\n", BENCH_ELEMENTS, BENCH_REPETITIONS, BENCH_SEED );
+
+	printSection( "Vector3f" );
+	runBenchmark( "operator+", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = a[i] + b[i]; return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "operator*( float )", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = a[i] * 0.5f; return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "dot", [&]() { float sum = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) sum += a[i].dot( b[i] ); return sum; } );
+	runBenchmark( "cross", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = a[i].cross( b[i] ); return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "magnitude", [&]() { float sum = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) sum += a[i].magnitude(); return sum; } );
+	runBenchmark( "normalize", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = a[i].normalize(); return out[BENCH_ELEMENTS - 1][0]; } );
+
+	printSection( "Vector4f (SSE)" );
+	runBenchmark( "operator+", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out4[i] = a4[i] + b4[i]; return out4[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "dot", [&]() { float sum = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) sum += a4[i].dot( b4[i] ); return sum; } );
+	runBenchmark( "cross", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out4[i] = a4[i].cross( b4[i] ); return out4[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "normalize", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out4[i] = a4[i].normalize(); return out4[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "normalizeFast", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out4[i] = a4[i].normalizeFast(); return out4[BENCH_ELEMENTS - 1][0]; } );
+
+	printSection( Vector3fArray::isUsingAvx2() ? "Vector3fArray (AVX2)" : "Vector3fArray (SSE)" );
+	runBenchmark( "add", [&]() { Vector3fArray::add( arrayA, arrayB, arrayOut ); return arrayOut.x()[0]; } );
+	runBenchmark( "dot", [&]() { Vector3fArray::dot( arrayA, arrayB, floatsOut ); return floatsOut[0]; } );
+	runBenchmark( "cross", [&]() { Vector3fArray::cross( arrayA, arrayB, arrayOut ); return arrayOut.x()[0]; } );
+	runBenchmark( "normalize", [&]() { Vector3fArray::normalize( arrayA, arrayOut ); return arrayOut.x()[0]; } );
+	runBenchmark( "rotate", [&]() { Vector3fArray::rotate( qa[0], arrayA, arrayOut ); return arrayOut.x()[0]; } );
+	Plane arrayPlane( Vector3f( 0.0f, 1.0f, 0.0f ), Vector3f( 0.0f, 3.0f, 0.0f ) );
+	runBenchmark( "planeDistance", [&]() { Vector3fArray::planeDistance( arrayPlane, arrayA, floatsOut ); return floatsOut[0]; } );
+
+	printSection( "Quaternion" );
+	runBenchmark( "operator*( Quaternion )", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) qOut[i] = qa[i] * qb[i]; return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+	runBenchmark( "operator*( Vector3f )", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = qa[i] * a[i]; return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "rotate", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = qa[i].rotate( a[i] ); return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "Matrix3f( q ) * v", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) out[i] = Matrix3f( qa[i] ) * a[i]; return out[BENCH_ELEMENTS - 1][0]; } );
+	runBenchmark( "Quaternion( axis, angle )", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) qOut[i] = Quaternion( a[i], inputs.angles[i] ); return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+	runBenchmark( "nlerp", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) qOut[i] = Quaternion::nlerp( qa[i], qb[i], 0.3f ); return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+	runBenchmark( "slerp", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) qOut[i] = Quaternion::slerp( qa[i], qb[i], 0.3f ); return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+	runBenchmark( "slerpFast", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) qOut[i] = Quaternion::slerpFast( qa[i], qb[i], 0.3f ); return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+	runBenchmark( "slerpFast batch", [&]() { Quaternion::slerpFast( qa, qb, 0.3f, qOut, BENCH_ELEMENTS ); return qOut[BENCH_ELEMENTS - 1].dot( qa[0] ); } );
+
+	printSection( "Plane" );
+	Plane plane( Vector3f( 1.0f, 2.0f, 3.0f ).normalize(), Vector3f( 4.0f, 5.0f, 6.0f ) );
+	runBenchmark( "isInPositiveHalfSpace", [&]() { float count = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) count += plane.isInPositiveHalfSpace( a[i] ) ? 1.0f : 0.0f; return count; } );
+	runBenchmark( "distanceTo", [&]() { float sum = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) sum += plane.distanceTo( a[i] ); return sum; } );
+
+	printSection( "Frustum" );
+	Frustum frustum( 60.0f, 0.75f, 1.0f, 150.0f, Vector3f( 0.0f, 0.0f, 0.0f ), qa[0] );
+	runBenchmark( "isPointInFrustum", [&]() { float count = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) count += frustum.isPointInFrustum( a[i] ) ? 1.0f : 0.0f; return count; } );
+	runBenchmark( "isSphereInFrustum", [&]() { float count = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) count += frustum.isSphereInFrustum( a[i], inputs.radii[i] ) ? 1.0f : 0.0f; return count; } );
+	runBenchmark( "classifySpheres", [&]() { frustum.classifySpheres( a, inputs.radii, BENCH_ELEMENTS, inputs.classifications ); return static_cast<float>( inputs.classifications[0] ); } );
+	runBenchmark( "setPosition + getCorners", [&]() { float sum = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) { frustum.setPosition( a[i] ); sum += frustum.getCorners()[0][0]; } return sum; } );
+
+	// Written to an array rather than summed, like the batch callers do, so the compiler
+	// is free to vectorize the approximations
+	printSection( "FastMath vs libm" );
+	const float * angles = inputs.angles;
+	const float * positives = inputs.positives;
+	runBenchmark( "sinf", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = sinf( angles[i] ); return floatsOut[0]; } );
+	runBenchmark( "fastSin", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = fastSin( angles[i] ); return floatsOut[0]; } );
+	runBenchmark( "cosf", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = cosf( angles[i] ); return floatsOut[0]; } );
+	runBenchmark( "fastCos", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = fastCos( angles[i] ); return floatsOut[0]; } );
+	runBenchmark( "tanf", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = tanf( angles[i] * 0.45f ); return floatsOut[0]; } );
+	runBenchmark( "fastTan", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = fastTan( angles[i] * 0.45f ); return floatsOut[0]; } );
+	runBenchmark( "1 / sqrtf", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = 1.0f / sqrtf( positives[i] ); return floatsOut[0]; } );
+	runBenchmark( "fastInverseSqrt", [&]() { for( int i = 0; i < BENCH_ELEMENTS; i++ ) floatsOut[i] = fastInverseSqrt( positives[i] ); return floatsOut[0]; } );
+	runBenchmark( "fastInverseSqrt batch", [&]() { fastInverseSqrt( positives, floatsOut, BENCH_ELEMENTS ); return floatsOut[0]; } );
+
+	printSection( "Quantize" );
+	PositionQuantizer quantizer( Vector3f( -100.0f, -100.0f, -100.0f ), 200.0f );
+	Vector3fArray normals( BENCH_ELEMENTS );
+	Vector3fArray::normalize( arrayA, normals );
+	runBenchmark( "PackedNormal::pack", [&]() { PackedNormal::pack( normals, inputs.packedNormals ); return inputs.packedNormals[0].unpack()[0]; } );
+	runBenchmark( "PackedNormal::unpack", [&]() { PackedNormal::unpack( inputs.packedNormals, arrayOut ); return arrayOut.x()[0]; } );
+	runBenchmark( "PositionQuantizer::pack", [&]() { quantizer.pack( arrayA, inputs.quantizedPositions ); return static_cast<float>( inputs.quantizedPositions[0].x ); } );
+	runBenchmark( "PositionQuantizer::unpack", [&]() { quantizer.unpack( inputs.quantizedPositions, arrayOut ); return arrayOut.x()[0]; } );
+	runBenchmark( "PackedQuaternion::pack", [&]() { PackedQuaternion::pack( qa, inputs.packedQuaternions, BENCH_ELEMENTS ); return inputs.packedQuaternions[0].unpack().dot( qa[0] ); } );
+	runBenchmark( "PackedQuaternion::unpack", [&]() { PackedQuaternion::unpack( inputs.packedQuaternions, qOut, BENCH_ELEMENTS ); return qOut[0].dot( qa[0] ); } );
+
+	// Whether Vector4f pays off in real code rather than single operations
+	printSection( "Terrain normals, per sample" );
+	static Vector3f faceNormals[BENCH_ELEMENTS];
+	static Vector4f faceNormals4[BENCH_ELEMENTS];
+	static Vector4f normals4[BENCH_ELEMENTS];
+	float heights[BENCH_ELEMENTS];
+	for( int i = 0; i < BENCH_ELEMENTS; i++ )
+	{
+		heights[i] = 0.25f * a[i][1];
+	}
+	runBenchmark( "Vector3f", [&]() { return computeGridNormals( heights, faceNormals, out ); } );
+	runBenchmark( "Vector4f", [&]() { return computeGridNormals( heights, faceNormals4, normals4 ); } );
+
+	printSection( "OBB collision, per box pair" );
+	static OrientedBoundingBox obbs[BENCH_ELEMENTS];
+	static BoxSet<Vector3f> boxes;
+	static BoxSet<Vector4f> boxes4;
+	for( int i = 0; i < BENCH_ELEMENTS; i++ )
+	{
+		Vector3f center = a[i] * 0.03f;
+		Vector3f halfLengths( 1.0f + inputs.radii[i] * 0.1f, 1.0f, 0.5f + inputs.radii[i] * 0.05f );
+		obbs[i] = OrientedBoundingBox( center, halfLengths, qa[i] );
+		OrientedBoundingBox::calculateCornerPoints( boxes.corners[i], center, halfLengths, qa[i] );
+		OrientedBoundingBox::calculateOrthogonalAxes( boxes.axes[i], qa[i] );
+		for( int j = 0; j < 8; j++ )
+		{
+			boxes4.corners[i][j] = Vector4f( boxes.corners[i][j] );
+		}
+		for( int j = 0; j < 3; j++ )
+		{
+			boxes4.axes[i][j] = Vector4f( boxes.axes[i][j] );
+		}
+	}
+	runBenchmark( "face tests, Vector3f", [&]() { return collideBoxes( boxes ); } );
+	runBenchmark( "face tests, Vector4f", [&]() { return collideBoxes( boxes4 ); } );
+	runBenchmark( "OrientedBoundingBox::collisionWith", [&]() { float count = 0.0f; for( int i = 0; i < BENCH_ELEMENTS; i++ ) count += obbs[i].collisionWith( obbs[( i + 1 ) % BENCH_ELEMENTS] ) ? 1.0f : 0.0f; return count; } );
+
+	reportFastMathAccuracy();
+
+	return 0;
+}
@@ -28,42 +28,42 @@ Camera::~Camera()
 void Camera::moveForward( float amount )
 {
 	// Rotate the default forward vector
-	Vector3f currentForward = mOrientation * Vector3f( 0.0f, 0.0f, -1.0f );
+	Vector3f currentForward = mOrientation.rotate( Vector3f( 0.0f, 0.0f, -1.0f ) );
 	mPosition += currentForward * amount;
 	mFrustum.setPosition( mPosition );
 }
 
 void Camera::moveBackward( float amount )
 {
-	Vector3f currentBackward = mOrientation * Vector3f( 0.0f, 0.0f, 1.0f );
+	Vector3f currentBackward = mOrientation.rotate( Vector3f( 0.0f, 0.0f, 1.0f ) );
 	mPosition += currentBackward * amount;
 	mFrustum.setPosition( mPosition );
 }
 
 void Camera::moveRight( float amount )
 {
-	Vector3f currentRight = mOrientation * Vector3f( 1.0f, 0.0f, 0.0f );
+	Vector3f currentRight = mOrientation.rotate( Vector3f( 1.0f, 0.0f, 0.0f ) );
 	mPosition += currentRight * amount;
 	mFrustum.setPosition( mPosition );
 }
 
 void Camera::moveLeft( float amount )
 {
-	Vector3f currentLeft = mOrientation * Vector3f( -1.0f, 0.0f, 0.0f );
+	Vector3f currentLeft = mOrientation.rotate( Vector3f( -1.0f, 0.0f, 0.0f ) );
 	mPosition += currentLeft * amount;
 	mFrustum.setPosition( mPosition );
 }
 
 void Camera::moveUp( float amount )
 {
-	Vector3f currentUp = mOrientation * Vector3f( 0.0f, 1.0f, 0.0f );
+	Vector3f currentUp = mOrientation.rotate( Vector3f( 0.0f, 1.0f, 0.0f ) );
 	mPosition += currentUp * amount;
 	mFrustum.setPosition( mPosition );
 }
 
 void Camera::moveDown( float amount )
 {
-	Vector3f currentDown = mOrientation * Vector3f( 0.0f, -1.0f, 0.0f );
+	Vector3f currentDown = mOrientation.rotate( Vector3f( 0.0f, -1.0f, 0.0f ) );
 	mPosition += currentDown * amount;
 	mFrustum.setPosition( mPosition );
 }
@@ -91,17 +91,24 @@ void Camera::rotatePitch( float pitchDegrees )
 // Actually does the world translation/rotation; the above only set them
 void Camera::look() const
 {
-	Vector3f axis;
-	float angle;
-	mOrientation.getAxisAndAngle( axis, angle );
-
-	glRotatef( -angle, axis[0], axis[1], axis[2] );
-	glTranslatef( -mPosition[0], -mPosition[1], -mPosition[2] );
+	// The view matrix is the inverse of the camera's own transform. Loading it
+	// directly replaces the identity the caller has just loaded, and avoids the
+	// acos() and sqrt() of going through glRotatef().
+	Matrix4f cameraTransform( Matrix3f( mOrientation ), mPosition );
+	glLoadMatrixf( cameraTransform.rigidInverse().getData() );
 }
 
 void Camera::perspective( float fovy, float aspectRatio, float nearClip, float farClip )
 {
 	gluPerspective( fovy, aspectRatio, nearClip, farClip );
-	mFrustum = Frustum( fovy, aspectRatio, nearClip, farClip, -mPosition, mOrientation.getConjugate() );
+	this->setFrustum( fovy, aspectRatio, nearClip, farClip );
+}
+
+// gluPerspective() takes the vertical FOV and width / height, while Frustum takes the
+// horizontal FOV and height / width
+void Camera::setFrustum( float fovy, float aspectRatio, float nearClip, float farClip )
+{
+	float horizontalFov = 2.0f * atan( tan( 0.5f * fovy * PI_OVER_180 ) * aspectRatio ) / PI_OVER_180;
+	mFrustum = Frustum( horizontalFov, 1.0f / aspectRatio, nearClip, farClip, mPosition, mOrientation );
 }
 
@@ -10,7 +10,11 @@ class Camera
 		Camera( const Vector3f & position, float yawDegrees, float pitchDegrees );
 		~Camera();
 
-		void setPosition( const Vector3f & position ) { mPosition = position; };
+		Vector3f getPosition() const { return mPosition; };
+		void setPosition( const Vector3f & position ) { mPosition = position; mFrustum.setPosition( mPosition ); };
+		Quaternion getOrientation() const { return mOrientation; };
+		// Replaces the yaw and pitch applied so far, e.g. with Quaternion::slerp() of two saved orientations
+		void setOrientation( const Quaternion & orientation ) { mOrientation = orientation; mFrustum.setOrientation( mOrientation ); };
 
 		Frustum getFrustum() const { return mFrustum; };
 
@@ -30,6 +34,9 @@ class Camera
 		// set the private member variables
 		void look() const;
 		void perspective( float fovy, float aspectRatio, float nearClip, float farClip );
+		// Shapes the frustum returned by getFrustum() to match a gluPerspective() call with
+		// the same arguments, without touching the GL projection matrix
+		void setFrustum( float fovy, float aspectRatio, float nearClip, float farClip );
 		
 	private:
 		Vector3f   mPosition;
@@ -10,7 +10,8 @@ enum EventType
 	MOUSE_MOVE,
 	MOUSE_CLICK,
 	MOUSE_UNCLICK,
-	MOUSE_SCROLL
+	MOUSE_SCROLL,
+	WINDOW_RESIZED
 };	
 
 enum KeyCode
@@ -159,6 +160,8 @@ struct Event
 	int					mousePosX;
 	int					mousePosY;
 	MouseButton			mouseButton;
+	int					windowWidth;		// New size, for WINDOW_RESIZED
+	int					windowHeight;
 };
 
 #endif
@@ -0,0 +1,103 @@
+#ifndef FAST_MATH_HPP
+#define FAST_MATH_HPP
+
+#include <cmath>
+
+#if defined( __SSE__ )
+	#include <xmmintrin.h>
+#endif
+
+// Approximations of libm functions for the hot math paths. They're only used in
+// place of libm when building with FAST_MATH_ON set to 1 (make FAST_MATH=1); the
+// math*() functions at the bottom pick one or the other. With FAST_MATH_ON at 0
+// they're the float libm functions and 1 / sqrtf(), not the double versions.
+#ifndef FAST_MATH_ON
+	#define FAST_MATH_ON 0
+#endif
+
+#define FAST_MATH_PI 3.14159265f
+#define FAST_MATH_TWO_PI 6.28318531f
+#define FAST_MATH_HALF_PI 1.57079633f
+
+/***************************************
+* Trig Kernels
+***************************************/
+// Odd degree 9 polynomial fitted for minimax error on [-pi/2, pi/2]. The angle is
+// wrapped into [-pi, pi], then reflected into [-pi/2, pi/2] using sin(pi - x) = sin(x).
+// Max absolute error is about 1.2e-7 for angles within [-pi, pi]; the wrap adds
+// roughly |radians| * 1e-7 on top of that for larger angles.
+inline float fastSin( float radians )
+{
+	float turns = radians * ( 1.0f / FAST_MATH_TWO_PI );
+	// Adding and subtracting 1.5 * 2^23 rounds to the nearest integer without leaving the
+	// float registers. Good for |turns| < 2^22, far beyond any angle this is used on.
+	float nearestTurn = ( turns + 12582912.0f ) - 12582912.0f;
+	float x = radians - FAST_MATH_TWO_PI * nearestTurn;
+
+	// |x| -> min( |x|, pi - |x| ) is the reflection, written so it compiles to minss
+	// rather than a branch that mispredicts on angles from random quadrants
+	float magnitude = fabsf( x );
+	float reflected = FAST_MATH_PI - magnitude;
+	x = copysignf( reflected < magnitude ? reflected : magnitude, x );
+
+	float x2 = x * x;
+	return x + x * x2 * ( -0.166666571f + x2 * ( 0.008333017301f + x2 * ( -0.0001980661583f + x2 * 2.600056004e-06f ) ) );
+}
+
+// cos(x) = sin(x + pi/2), same error bound as fastSin()
+inline float fastCos( float radians )
+{
+	return fastSin( radians + FAST_MATH_HALF_PI );
+}
+
+// Relative error is under 2.5e-6 for |x| <= 1.5, growing near the poles at +-pi/2 like tan() itself
+inline float fastTan( float radians )
+{
+	return fastSin( radians ) / fastCos( radians );
+}
+
+/***************************************
+* Inverse Square Root Kernels
+***************************************/
+// Hardware estimate (12 bits) refined with one Newton-Raphson step to about 22 bits
+inline float fastInverseSqrt( float value )
+{
+#if defined( __SSE__ )
+	float estimate = _mm_cvtss_f32( _mm_rsqrt_ss( _mm_set_ss( value ) ) );
+	return estimate * ( 1.5f - 0.5f * value * estimate * estimate );
+#else
+	return 1.0f / sqrtf( value );
+#endif
+}
+
+// Batch version of fastInverseSqrt(), 4 values per instruction. results may be the same array as values.
+inline void fastInverseSqrt( const float * values, float * results, int count )
+{
+	int i = 0;
+#if defined( __SSE__ )
+	const __m128 half = _mm_set1_ps( 0.5f );
+	const __m128 threeHalves = _mm_set1_ps( 1.5f );
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 value = _mm_loadu_ps( values + i );
+		__m128 estimate = _mm_rsqrt_ps( value );
+		__m128 correction = _mm_sub_ps( threeHalves, _mm_mul_ps( _mm_mul_ps( half, value ), _mm_mul_ps( estimate, estimate ) ) );
+		_mm_storeu_ps( results + i, _mm_mul_ps( estimate, correction ) );
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		results[i] = fastInverseSqrt( values[i] );
+	}
+}
+
+/***************************************
+* Build-time Selection
+***************************************/
+// Hot paths call these, so FAST_MATH_ON switches all of them at once
+inline float mathSin( float radians ) { return FAST_MATH_ON ? fastSin( radians ) : sinf( radians ); }
+inline float mathCos( float radians ) { return FAST_MATH_ON ? fastCos( radians ) : cosf( radians ); }
+inline float mathTan( float radians ) { return FAST_MATH_ON ? fastTan( radians ) : tanf( radians ); }
+inline float mathInverseSqrt( float value ) { return FAST_MATH_ON ? fastInverseSqrt( value ) : 1.0f / sqrtf( value ); }
+
+#endif
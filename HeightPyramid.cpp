@@ -0,0 +1,190 @@
+#include "HeightPyramid.hpp"
+#include <algorithm>
+#include <thread>
+
+/***************************************
+* Class Methods
+***************************************/
+void HeightPyramid::build( const uint16_t * samples, int width, int length, float heightScale, float heightOffset )
+{
+	mLevels.clear();
+	mWidth = width;
+	mLength = length;
+	mHeightScale = heightScale;
+	mHeightOffset = heightOffset;
+	if( width < 2 || length < 2 )
+	{
+		return;
+	}
+
+	// Odd sizes leave the last entry of a level with only one child along that axis
+	int levelWidth = width - 1;
+	int levelLength = length - 1;
+	while( true )
+	{
+		Level level;
+		level.width = levelWidth;
+		level.length = levelLength;
+		level.minSamples.resize( levelWidth * levelLength );
+		level.maxSamples.resize( levelWidth * levelLength );
+		mLevels.push_back( level );
+
+		if( levelWidth == 1 && levelLength == 1 )
+		{
+			break;
+		}
+		levelWidth = ( levelWidth + 1 ) / 2;
+		levelLength = ( levelLength + 1 ) / 2;
+	}
+
+	// Each level needs the whole level below, so the threads only split a level's rows
+	int maxThreads = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+	for( unsigned int level = 0; level < mLevels.size(); level++ )
+	{
+		int rows = mLevels[level].width;
+		int threadCount = std::max( 1, std::min( maxThreads, rows / HEIGHT_PYRAMID_MIN_ROWS_PER_THREAD ) );
+		int rowsPerThread = ( rows + threadCount - 1 ) / threadCount;
+
+		std::vector<std::thread> threads;
+		for( int startX = rowsPerThread; startX < rows; startX += rowsPerThread )
+		{
+			threads.push_back( std::thread( &HeightPyramid::computeEntries, this, samples, level, startX, std::min( startX + rowsPerThread, rows ), 0, mLevels[level].length ) );
+		}
+		computeEntries( samples, level, 0, std::min( rowsPerThread, rows ), 0, mLevels[level].length );
+
+		for( unsigned int i = 0; i < threads.size(); i++ )
+		{
+			threads[i].join();
+		}
+	}
+}
+
+void HeightPyramid::update( const uint16_t * samples, int startX, int startZ, int endX, int endZ )
+{
+	if( mLevels.empty() )
+	{
+		return;
+	}
+
+	// A sample is a corner of the quads on both sides of it
+	startX = std::max( startX - 1, 0 );
+	startZ = std::max( startZ - 1, 0 );
+	endX = std::min( endX, mLevels[0].width - 1 );
+	endZ = std::min( endZ, mLevels[0].length - 1 );
+	for( unsigned int level = 0; level < mLevels.size() && startX <= endX && startZ <= endZ; level++ )
+	{
+		computeEntries( samples, level, startX, endX + 1, startZ, endZ + 1 );
+		startX /= 2;
+		startZ /= 2;
+		endX /= 2;
+		endZ /= 2;
+	}
+}
+
+bool HeightPyramid::getHeightRange( int startX, int startZ, int endX, int endZ, float & minHeight, float & maxHeight ) const
+{
+	if( mLevels.empty() )
+	{
+		return false;
+	}
+
+	startX = std::max( startX, 0 );
+	startZ = std::max( startZ, 0 );
+	endX = std::min( endX, mLevels[0].width );
+	endZ = std::min( endZ, mLevels[0].length );
+	if( startX >= endX || startZ >= endZ )
+	{
+		return false;
+	}
+
+	// Start with an empty range, which the first entry visited replaces
+	const Level & top = mLevels.back();
+	uint16_t minSample = top.maxSamples[0];
+	uint16_t maxSample = top.minSamples[0];
+	getNodeRange( mLevels.size() - 1, 0, 0, startX, startZ, endX, endZ, minSample, maxSample );
+	minHeight = toHeight( minSample );
+	maxHeight = toHeight( maxSample );
+	return true;
+}
+
+void HeightPyramid::computeEntries( const uint16_t * samples, int level, int startX, int endX, int startZ, int endZ )
+{
+	Level & entries = mLevels[level];
+	if( level == 0 )
+	{
+		for( int x = startX; x < endX; x++ )
+		{
+			const uint16_t *row = &samples[x * mLength];
+			const uint16_t *nextRow = row + mLength;
+			for( int z = startZ; z < endZ; z++ )
+			{
+				entries.minSamples[x * entries.length + z] = std::min( std::min( row[z], row[z + 1] ), std::min( nextRow[z], nextRow[z + 1] ) );
+				entries.maxSamples[x * entries.length + z] = std::max( std::max( row[z], row[z + 1] ), std::max( nextRow[z], nextRow[z + 1] ) );
+			}
+		}
+		return;
+	}
+
+	const Level & below = mLevels[level - 1];
+	for( int x = startX; x < endX; x++ )
+	{
+		for( int z = startZ; z < endZ; z++ )
+		{
+			int childX = 2 * x;
+			int childZ = 2 * z;
+			int lastX = std::min( childX + 1, below.width - 1 );
+			int lastZ = std::min( childZ + 1, below.length - 1 );
+			uint16_t lower = below.minSamples[childX * below.length + childZ];
+			uint16_t upper = below.maxSamples[childX * below.length + childZ];
+			for( int i = childX; i <= lastX; i++ )
+			{
+				for( int j = childZ; j <= lastZ; j++ )
+				{
+					lower = std::min( lower, below.minSamples[i * below.length + j] );
+					upper = std::max( upper, below.maxSamples[i * below.length + j] );
+				}
+			}
+			entries.minSamples[x * entries.length + z] = lower;
+			entries.maxSamples[x * entries.length + z] = upper;
+		}
+	}
+}
+
+void HeightPyramid::getNodeRange( int level, int x, int z, int startX, int startZ, int endX, int endZ, uint16_t & minSample, uint16_t & maxSample ) const
+{
+	// Quads the entry covers
+	int size = 1 << level;
+	int nodeStartX = x * size;
+	int nodeStartZ = z * size;
+	int nodeEndX = std::min( nodeStartX + size, mLevels[0].width );
+	int nodeEndZ = std::min( nodeStartZ + size, mLevels[0].length );
+	if( nodeStartX >= endX || nodeEndX <= startX || nodeStartZ >= endZ || nodeEndZ <= startZ )
+	{
+		return;
+	}
+
+	// Nothing inside can widen the range found so far
+	const Level & entries = mLevels[level];
+	uint16_t nodeMin = entries.minSamples[x * entries.length + z];
+	uint16_t nodeMax = entries.maxSamples[x * entries.length + z];
+	if( nodeMin >= minSample && nodeMax <= maxSample )
+	{
+		return;
+	}
+
+	bool isInside = nodeStartX >= startX && nodeEndX <= endX && nodeStartZ >= startZ && nodeEndZ <= endZ;
+	if( isInside || level == 0 )
+	{
+		minSample = std::min( minSample, nodeMin );
+		maxSample = std::max( maxSample, nodeMax );
+		return;
+	}
+
+	for( int childX = 2 * x; childX < std::min( 2 * x + 2, mLevels[level - 1].width ); childX++ )
+	{
+		for( int childZ = 2 * z; childZ < std::min( 2 * z + 2, mLevels[level - 1].length ); childZ++ )
+		{
+			getNodeRange( level - 1, childX, childZ, startX, startZ, endX, endZ, minSample, maxSample );
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef HEIGHT_PYRAMID_HPP
+#define HEIGHT_PYRAMID_HPP
+
+#include <vector>
+#include <stdint.h>
+
+// Fewer rows than this aren't worth starting another thread for when building a level
+#define HEIGHT_PYRAMID_MIN_ROWS_PER_THREAD 64
+
+// Min and max heights over square blocks of a heightmap's quads, sometimes called a
+// maximum mipmap. Level 0 has one entry per quad, from its four corner samples, and
+// each level above covers 2x2 entries of the one below, up to a single entry for the
+// whole map. Shared by culling, picking and collision to skip large areas of the map
+// at once. Entries are kept as raw 16-bit samples, the same as Terrain's heightmap, and
+// converted to heights with its scale and offset when read.
+class HeightPyramid
+{
+	public:
+		HeightPyramid() : mWidth( 0 ), mLength( 0 ), mHeightScale( 1.0f ), mHeightOffset( 0.0f ) {};
+
+		// samples is indexed x * length + z, the same as Terrain's heightmap, and a sample's
+		// height is heightOffset + sample * heightScale, where heightScale is positive.
+		// Each level's rows are split between threads.
+		void build( const uint16_t * samples, int width, int length, float heightScale, float heightOffset );
+		// Recomputes the entries covering samples [startX, endX] x [startZ, endZ] after
+		// they've changed, from the same samples array build() was given
+		void update( const uint16_t * samples, int startX, int startZ, int endX, int endZ );
+
+		// Height range over the quads [startX, endX) x [startZ, endZ), i.e. over samples
+		// startX to endX inclusive. Whole entries inside the rectangle are used as they
+		// are, so a power of two aligned block is a single lookup; otherwise the cost
+		// grows with the length of the rectangle's edges. False if the rectangle is empty
+		// once clipped to the map.
+		bool getHeightRange( int startX, int startZ, int endX, int endZ, float & minHeight, float & maxHeight ) const;
+
+		int getLevelCount() const { return mLevels.size(); };
+		// Entries along x and z of a level
+		int getLevelWidth( int level ) const { return mLevels[level].width; };
+		int getLevelLength( int level ) const { return mLevels[level].length; };
+		float getMinHeight( int level, int x, int z ) const { return toHeight( mLevels[level].minSamples[x * mLevels[level].length + z] ); };
+		float getMaxHeight( int level, int x, int z ) const { return toHeight( mLevels[level].maxSamples[x * mLevels[level].length + z] ); };
+
+	private:
+		struct Level
+		{
+			int					width;
+			int					length;
+			std::vector<uint16_t>	minSamples;
+			std::vector<uint16_t>	maxSamples;
+		};
+
+		float toHeight( uint16_t sample ) const { return mHeightOffset + sample * mHeightScale; };
+		// Fills entries [startX, endX) x [startZ, endZ) of a level from the samples, for
+		// level 0, or from the level below
+		void computeEntries( const uint16_t * samples, int level, int startX, int endX, int startZ, int endZ );
+		void getNodeRange( int level, int x, int z, int startX, int startZ, int endX, int endZ, uint16_t & minSample, uint16_t & maxSample ) const;
+
+		std::vector<Level>	mLevels;
+		int					mWidth;		// Samples of the heightmap along x and z
+		int					mLength;
+		float				mHeightScale;
+		float				mHeightOffset;
+};
+
+#endif
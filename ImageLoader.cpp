@@ -2,6 +2,8 @@
 #include "Debug.hpp"
 #include <fstream>
 #include <cmath>
+#include <cctype>
+#include <algorithm>
 
 void loadBitmap( const std::string & filename, unsigned char *& pixels, int & width, int & height )
 {
@@ -52,6 +54,7 @@ void loadBitmap( const std::string & filename, unsigned char *& pixels, int & wi
 		}
 	}
 
+	delete [] rawPixelData;
 	infile.close();
 }
 
@@ -109,6 +112,132 @@ void saveBitmap( const std::string & filename, unsigned char *pixels, int width,
 	}
 
 	outfile.write( rawPixelData, pixelArraySize );
+	delete [] rawPixelData;
 
 	outfile.close();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Heightmaps
+////////////////////////////////////////////////////////////////////////////////
+static bool hasExtension( const std::string & filename, const std::string & extension )
+{
+	if( filename.size() < extension.size() )
+	{
+		return false;
+	}
+	std::string ending = filename.substr( filename.size() - extension.size() );
+	for( unsigned int i = 0; i < ending.size(); i++ )
+	{
+		ending[i] = tolower( ending[i] );
+	}
+	return ending == extension;
+}
+
+static void loadRawHeightmap( const std::string & filename, uint16_t *& heights, int & width, int & height )
+{
+	std::ifstream infile( filename.c_str(), std::ios::in | std::ios::binary );
+	fatalAssert( !infile.fail(), "Could not find \'" + filename + "\'." );
+
+	infile.seekg( 0, std::ios_base::end );
+	long fileSize = infile.tellg();
+	fatalAssert( fileSize >= 0, "Cannot load \'" + filename + "\', its size could not be read." );
+	long sampleCount = fileSize / 2;
+	infile.seekg( 0, std::ios_base::beg );
+
+	// No header, so the size has to come from the file's length. Terrain needs at least
+	// one quad, i.e. 2x2 samples.
+	width = static_cast<int>( sqrt( static_cast<double>( sampleCount ) ) + 0.5 );
+	height = width;
+	fatalAssert( sampleCount >= 4 && static_cast<long>( width ) * width == sampleCount, "Cannot load \'" + filename + "\', raw heightmaps must be square and at least 2x2." );
+
+	unsigned char *bytes = new unsigned char[2 * sampleCount];
+	infile.read( reinterpret_cast<char *>( bytes ), 2 * sampleCount );
+	fatalAssert( infile.gcount() == 2 * sampleCount, "Cannot load \'" + filename + "\', it is truncated." );
+	heights = new uint16_t[sampleCount];
+	for( long i = 0; i < sampleCount; i++ )
+	{
+		heights[i] = static_cast<uint16_t>( bytes[2 * i] | ( bytes[2 * i + 1] << 8 ) );
+	}
+	delete [] bytes;
+}
+
+// Reads the next number of a PGM header, skipping whitespace and comments
+static int readPgmValue( std::ifstream & infile )
+{
+	int character = infile.get();
+	while( isspace( character ) || character == '#' )
+	{
+		if( character == '#' )
+		{
+			while( character != '\n' && character != EOF )
+			{
+				character = infile.get();
+			}
+		}
+		character = infile.get();
+	}
+
+	int value = 0;
+	while( isdigit( character ) )
+	{
+		value = 10 * value + ( character - '0' );
+		character = infile.get();
+	}
+	return value;    // The single whitespace after the value has been consumed
+}
+
+static void loadPgmHeightmap( const std::string & filename, uint16_t *& heights, int & width, int & height )
+{
+	std::ifstream infile( filename.c_str(), std::ios::in | std::ios::binary );
+	fatalAssert( !infile.fail(), "Could not find \'" + filename + "\'." );
+
+	char magicNumber[2];
+	infile.read( magicNumber, 2 );
+	fatalAssert( magicNumber[0] == 'P' && magicNumber[1] == '5', "\'" + filename + "\' is not a binary PGM file." );
+
+	width = readPgmValue( infile );
+	height = readPgmValue( infile );
+	int maxValue = readPgmValue( infile );
+	fatalAssert( width > 0 && height > 0 && maxValue > 0 && maxValue < 65536, "Cannot load \'" + filename + "\', its header is invalid." );
+
+	// Samples are 2 bytes, most significant first, if they don't fit in one
+	int bytesPerSample = maxValue > 255 ? 2 : 1;
+	long sampleCount = static_cast<long>( width ) * height;
+	unsigned char *bytes = new unsigned char[bytesPerSample * sampleCount];
+	infile.read( reinterpret_cast<char *>( bytes ), bytesPerSample * sampleCount );
+	fatalAssert( infile.gcount() == bytesPerSample * sampleCount, "Cannot load \'" + filename + "\', it is truncated." );
+
+	heights = new uint16_t[sampleCount];
+	for( long i = 0; i < sampleCount; i++ )
+	{
+		int value = bytesPerSample == 2 ? ( bytes[2 * i] << 8 ) | bytes[2 * i + 1] : bytes[i];
+		value = std::min( value, maxValue );
+		heights[i] = static_cast<uint16_t>( ( static_cast<long>( value ) * 65535 + maxValue / 2 ) / maxValue );
+	}
+	delete [] bytes;
+}
+
+void loadHeightmap( const std::string & filename, uint16_t *& heights, int & width, int & height )
+{
+	if( hasExtension( filename, ".r16" ) || hasExtension( filename, ".raw" ) )
+	{
+		loadRawHeightmap( filename, heights, width, height );
+		return;
+	}
+	if( hasExtension( filename, ".pgm" ) )
+	{
+		loadPgmHeightmap( filename, heights, width, height );
+		return;
+	}
+
+	// 257 maps 255 to 65535
+	unsigned char *pixels = NULL;
+	loadBitmap( filename, pixels, width, height );
+	heights = new uint16_t[width * height];
+	for( int i = 0; i < width * height; i++ )
+	{
+		heights[i] = pixels[3 * i] * 257;
+	}
+	delete [] pixels;
+}
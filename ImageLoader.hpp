@@ -39,5 +39,11 @@ struct BmpInfoHeader
 ////////////////////////////////////////////////////////////////////////////////
 void loadBitmap( const std::string & filename, unsigned char *& pixels, int & width, int & height );
 void saveBitmap( const std::string & filename, unsigned char *pixels, int width, int height );
+// Grayscale heightmaps, 16 bits per sample, stored heights[row * width + column] with
+// rows in file order; width and height may differ. Picked by extension: .r16 or .raw
+// is headerless little endian and must be square, .pgm is binary (P5) with any maxval,
+// and anything else is loaded with loadBitmap() using its red channel. Samples are
+// scaled to the full 0 to 65535 range.
+void loadHeightmap( const std::string & filename, uint16_t *& heights, int & width, int & height );
 
 #endif
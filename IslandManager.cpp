@@ -0,0 +1,105 @@
+#include "IslandManager.hpp"
+
+void IslandManager::update( const std::vector<OrientedBoundingBox *> & boxes, const std::vector<BoxPair> & contactPairs )
+{
+    std::map<const OrientedBoundingBox *, int> indices;
+    mParents.resize( boxes.size() );
+    for( unsigned int i = 0; i < boxes.size(); i++ )
+    {
+        indices[boxes[i]] = i;
+        mParents[i] = i;
+    }
+
+    // Merge this frame's contacts with the ones kept from sleeping islands
+    std::set<ContactKey> contacts = mSleepingContacts;
+    for( std::vector<BoxPair>::const_iterator it = contactPairs.begin(); it != contactPairs.end(); ++it )
+    {
+        contacts.insert( ContactKey( it->box1, it->box2 ) );
+    }
+
+    for( std::set<ContactKey>::const_iterator it = contacts.begin(); it != contacts.end(); ++it )
+    {
+        std::map<const OrientedBoundingBox *, int>::const_iterator first = indices.find( it->first );
+        std::map<const OrientedBoundingBox *, int>::const_iterator second = indices.find( it->second );
+        if( first != indices.end() && second != indices.end() )
+        {
+            unite( first->second, second->second );
+        }
+    }
+
+    // An island wakes up if any of its boxes moved, and can only fall asleep once
+    // every box in it has been resting long enough
+    std::vector<bool> islandMoved( boxes.size(), false );
+    std::vector<bool> islandRested( boxes.size(), true );
+    for( unsigned int i = 0; i < boxes.size(); i++ )
+    {
+        int root = findRoot( i );
+        if( boxes[i]->updateRestState() )
+        {
+            islandMoved[root] = true;
+        }
+        if( boxes[i]->getFramesAtRest() < SLEEP_FRAMES )
+        {
+            islandRested[root] = false;
+        }
+    }
+
+    for( unsigned int i = 0; i < boxes.size(); i++ )
+    {
+        int root = findRoot( i );
+        if( islandMoved[root] )
+        {
+            boxes[i]->wakeUp();
+        }
+        else if( islandRested[root] )
+        {
+            boxes[i]->sleep();
+        }
+    }
+
+    mSleepingContacts.clear();
+    for( std::set<ContactKey>::const_iterator it = contacts.begin(); it != contacts.end(); ++it )
+    {
+        if( it->first->isAsleep() && it->second->isAsleep() )
+        {
+            mSleepingContacts.insert( *it );
+        }
+    }
+}
+
+void IslandManager::removeBox( const OrientedBoundingBox * box )
+{
+    std::set<ContactKey>::iterator it = mSleepingContacts.begin();
+    while( it != mSleepingContacts.end() )
+    {
+        if( it->first == box || it->second == box )
+        {
+            mSleepingContacts.erase( it++ );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+int IslandManager::findRoot( int index )
+{
+    // Path halving keeps the trees flat
+    while( mParents[index] != index )
+    {
+        mParents[index] = mParents[mParents[index]];
+        index = mParents[index];
+    }
+    return index;
+}
+
+void IslandManager::unite( int index1, int index2 )
+{
+    int root1 = findRoot( index1 );
+    int root2 = findRoot( index2 );
+    if( root1 != root2 )
+    {
+        mParents[root2] = root1;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef ISLAND_MANAGER_HPP
+#define ISLAND_MANAGER_HPP
+
+#include "OrientedBoundingBox.hpp"
+#include "Octree.hpp"
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Puts boxes to sleep once they've been resting for SLEEP_FRAMES, and wakes them
+// back up. Boxes in contact form an island, which sleeps and wakes as a whole, so a
+// box landing on a sleeping stack wakes every box in the stack.
+class IslandManager
+{
+    public:
+        // Call once per frame after the narrowphase, with every box in the world and
+        // the pairs that were found to be touching.
+        void update( const std::vector<OrientedBoundingBox *> & boxes, const std::vector<BoxPair> & contactPairs );
+        // Forget about a box that is being removed from the world
+        void removeBox( const OrientedBoundingBox * box );
+
+    private:
+        typedef std::pair<OrientedBoundingBox *, OrientedBoundingBox *> ContactKey;
+
+        // Union-find over indices into the boxes passed to update()
+        int findRoot( int index );
+        void unite( int index1, int index2 );
+
+        std::vector<int> mParents;
+        // Contacts between sleeping boxes. The broadphase skips those pairs, so they're
+        // remembered here to keep sleeping islands together until they wake up.
+        std::set<ContactKey> mSleepingContacts;
+};
+
+#endif
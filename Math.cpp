@@ -1,180 +1,224 @@
 #include "Math.hpp"
 #include <GL/glut.h>
 
-#define PI_OVER_180 0.0174532925f
+#if defined( __SSE__ )
+	#include <xmmintrin.h>
+#endif
 
 /***********************************************************
- * Vector Class Methods
+ * Quaternion Class Methods
  **********************************************************/
-Vector3f::Vector3f()
-{
-	mComponents[0] = 0.0f;
-	mComponents[1] = 0.0f;
-	mComponents[2] = 0.0f;
-}
-
-Vector3f::Vector3f( float x, float y, float z )
-{
-	mComponents[0] = x;
-	mComponents[1] = y;
-	mComponents[2] = z;
-}
-
-const Vector3f & Vector3f::operator*=( float scale )
-{
-	mComponents[0] *= scale;
-	mComponents[1] *= scale;
-	mComponents[2] *= scale;
-	return *this;
-}
-
-const Vector3f & Vector3f::operator/=( float scale )
-{
-	mComponents[0] /= scale;
-	mComponents[1] /= scale;
-	mComponents[2] /= scale;
-	return *this;
-}
-
-const Vector3f & Vector3f::operator+=( const Vector3f & rhs )
-{
-	mComponents[0] += rhs.mComponents[0];
-	mComponents[1] += rhs.mComponents[1];
-	mComponents[2] += rhs.mComponents[2];
-	return *this;
-}
-
-const Vector3f & Vector3f::operator-=( const Vector3f & rhs )
-{
-	mComponents[0] -= rhs.mComponents[0];
-	mComponents[1] -= rhs.mComponents[1];
-	mComponents[2] -= rhs.mComponents[2];
-	return *this;
-}
-
-Vector3f Vector3f::normalize() const
-{
-	float mag = this->magnitude();
-	return Vector3f( mComponents[0] / mag, mComponents[1] / mag, mComponents[2] / mag );
-}
-
-std::ostream &operator<<( std::ostream & os, const Vector3f & vector )
+// Quaternions are 4 packed floats, so 4 of them load as a 4x4 block that is
+// transposed to get all w's, x's, y's and z's in one register each. Then every
+// step of slerpFast() runs on 4 quaternions at once.
+void Quaternion::slerpFast( const Quaternion * from, const Quaternion * to, float t, Quaternion * out, int count )
 {
-    std::cout << '(' << vector[0] << ", " << vector[1] << ", " << vector[2] << ')';
-	return os;
+	int i = 0;
+#if defined( __SSE__ )
+	static_assert( sizeof( Quaternion ) == 4 * sizeof( float ), "Quaternion should be 4 packed floats" );
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	const __m128 tLane = _mm_set1_ps( t );
+	const __m128 tMinusHalf = _mm_set1_ps( t - 0.5f );
+	// t(t - 0.5)(t - 1) is the same for every quaternion
+	const __m128 bend = _mm_set1_ps( t * ( t - 0.5f ) * ( t - 1.0f ) );
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		const float * fromFloats = &from[i].w;
+		const float * toFloats = &to[i].w;
+		__m128 fw = _mm_loadu_ps( fromFloats );
+		__m128 fx = _mm_loadu_ps( fromFloats + 4 );
+		__m128 fy = _mm_loadu_ps( fromFloats + 8 );
+		__m128 fz = _mm_loadu_ps( fromFloats + 12 );
+		__m128 tw = _mm_loadu_ps( toFloats );
+		__m128 tx = _mm_loadu_ps( toFloats + 4 );
+		__m128 ty = _mm_loadu_ps( toFloats + 8 );
+		__m128 tz = _mm_loadu_ps( toFloats + 12 );
+		_MM_TRANSPOSE4_PS( fw, fx, fy, fz );
+		_MM_TRANSPOSE4_PS( tw, tx, ty, tz );
+
+		__m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( fw, tw ), _mm_mul_ps( fx, tx ) ), _mm_add_ps( _mm_mul_ps( fy, ty ), _mm_mul_ps( fz, tz ) ) );
+		__m128 d = _mm_andnot_ps( signMask, dot );
+
+		__m128 a = _mm_sub_ps( _mm_set1_ps( 3.55645f ), _mm_mul_ps( d, _mm_set1_ps( 1.43519f ) ) );
+		a = _mm_add_ps( _mm_set1_ps( -3.2452f ), _mm_mul_ps( d, a ) );
+		a = _mm_add_ps( _mm_set1_ps( 1.0904f ), _mm_mul_ps( d, a ) );
+		__m128 b = _mm_add_ps( _mm_set1_ps( -1.06021f ), _mm_mul_ps( d, _mm_set1_ps( 0.215638f ) ) );
+		b = _mm_add_ps( _mm_set1_ps( 0.848013f ), _mm_mul_ps( d, b ) );
+		__m128 k = _mm_add_ps( _mm_mul_ps( a, _mm_mul_ps( tMinusHalf, tMinusHalf ) ), b );
+		__m128 correctedT = _mm_add_ps( tLane, _mm_mul_ps( bend, k ) );
+
+		// Flip the sign of to's weight where the dot product is negative
+		__m128 fromWeight = _mm_sub_ps( _mm_set1_ps( 1.0f ), correctedT );
+		__m128 toWeight = _mm_xor_ps( correctedT, _mm_and_ps( _mm_cmplt_ps( dot, zero ), signMask ) );
+
+		__m128 w = _mm_add_ps( _mm_mul_ps( fw, fromWeight ), _mm_mul_ps( tw, toWeight ) );
+		__m128 x = _mm_add_ps( _mm_mul_ps( fx, fromWeight ), _mm_mul_ps( tx, toWeight ) );
+		__m128 y = _mm_add_ps( _mm_mul_ps( fy, fromWeight ), _mm_mul_ps( ty, toWeight ) );
+		__m128 z = _mm_add_ps( _mm_mul_ps( fz, fromWeight ), _mm_mul_ps( tz, toWeight ) );
+
+		// rsqrt estimate plus one Newton-Raphson step, same as fastInverseSqrt()
+		__m128 magnitudeSquared = _mm_add_ps( _mm_add_ps( _mm_mul_ps( w, w ), _mm_mul_ps( x, x ) ), _mm_add_ps( _mm_mul_ps( y, y ), _mm_mul_ps( z, z ) ) );
+		__m128 estimate = _mm_rsqrt_ps( magnitudeSquared );
+		__m128 inverseMagnitude = _mm_mul_ps( estimate, _mm_sub_ps( _mm_set1_ps( 1.5f ), _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), magnitudeSquared ), _mm_mul_ps( estimate, estimate ) ) ) );
+		w = _mm_mul_ps( w, inverseMagnitude );
+		x = _mm_mul_ps( x, inverseMagnitude );
+		y = _mm_mul_ps( y, inverseMagnitude );
+		z = _mm_mul_ps( z, inverseMagnitude );
+
+		_MM_TRANSPOSE4_PS( w, x, y, z );
+		float * outFloats = &out[i].w;
+		_mm_storeu_ps( outFloats, w );
+		_mm_storeu_ps( outFloats + 4, x );
+		_mm_storeu_ps( outFloats + 8, y );
+		_mm_storeu_ps( outFloats + 12, z );
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		out[i] = Quaternion::slerpFast( from[i], to[i], t );
+	}
 }
 
 /***********************************************************
- * Quaternion Class Methods
+ * Matrix3f Class Methods
  **********************************************************/
-Quaternion::Quaternion() :
-	w( 1.0f ),
-	x( 0.0f ),
-	y( 0.0f ),
-	z( 0.0f )
-{
-	// Already normalized
-}
-
-Quaternion::Quaternion( float W, float X, float Y, float Z ) :
-	w( W ),
-	x( X ),
-	y( Y ),
-	z( Z )
+Matrix3f::Matrix3f()
 {
-	this->normalize();
+	for( int i = 0; i < 9; i++ )
+	{
+		mElements[i] = 0.0f;
+	}
+	mElements[0] = 1.0f;
+	mElements[4] = 1.0f;
+	mElements[8] = 1.0f;
 }
 
-Quaternion::Quaternion( const Vector3f & axis, float angle )
+// Assumes the quaternion is normalized, which its constructors make sure of
+Matrix3f::Matrix3f( const Quaternion & rotation )
 {
-	angle *= PI_OVER_180;
-	angle *= 0.5f;
-
-	float s = sin( angle );
-
-	Vector3f normalAxis = axis.normalize();
-
-	w = cos( angle );
-	x = normalAxis[0] * s;
-	y = normalAxis[1] * s;
-	z = normalAxis[2] * s;
-
-	this->normalize();
+	float xx = rotation.x * rotation.x;
+	float yy = rotation.y * rotation.y;
+	float zz = rotation.z * rotation.z;
+	float xy = rotation.x * rotation.y;
+	float xz = rotation.x * rotation.z;
+	float yz = rotation.y * rotation.z;
+	float wx = rotation.w * rotation.x;
+	float wy = rotation.w * rotation.y;
+	float wz = rotation.w * rotation.z;
+
+	( *this )( 0, 0 ) = 1.0f - 2.0f * ( yy + zz );
+	( *this )( 0, 1 ) = 2.0f * ( xy - wz );
+	( *this )( 0, 2 ) = 2.0f * ( xz + wy );
+	( *this )( 1, 0 ) = 2.0f * ( xy + wz );
+	( *this )( 1, 1 ) = 1.0f - 2.0f * ( xx + zz );
+	( *this )( 1, 2 ) = 2.0f * ( yz - wx );
+	( *this )( 2, 0 ) = 2.0f * ( xz - wy );
+	( *this )( 2, 1 ) = 2.0f * ( yz + wx );
+	( *this )( 2, 2 ) = 1.0f - 2.0f * ( xx + yy );
 }
 
-Quaternion::~Quaternion()
+Matrix3f Matrix3f::operator*( const Matrix3f & rhs ) const
 {
+	Matrix3f result;
+	for( int column = 0; column < 3; column++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			result( row, column ) = ( *this )( row, 0 ) * rhs( 0, column ) +
+			                        ( *this )( row, 1 ) * rhs( 1, column ) +
+			                        ( *this )( row, 2 ) * rhs( 2, column );
+		}
+	}
+	return result;
 }
 
-// Multiplying a quaternion q with a vector v applies the q-rotation to v
-// To apply a quaternion-rotation to a vector, you need to multiply the
-// vector by the quaternion and its conjugate
-Vector3f Quaternion::operator*( const Vector3f & vector ) const
+Matrix3f Matrix3f::transpose() const
 {
-	Vector3f normalizedVector = vector.normalize();
- 
-	Quaternion vectorQuaternion;
-	vectorQuaternion.x = normalizedVector[0];
-	vectorQuaternion.y = normalizedVector[1];
-	vectorQuaternion.z = normalizedVector[2];
-	vectorQuaternion.w = 0.0f;
- 
-	Quaternion resultQuaternion = *this * ( vectorQuaternion * getConjugate() );
- 
-	return Vector3f( resultQuaternion.x, resultQuaternion.y, resultQuaternion.z );
+	Matrix3f result;
+	for( int column = 0; column < 3; column++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			result( row, column ) = ( *this )( column, row );
+		}
+	}
+	return result;
 }
 
-Quaternion & Quaternion::operator=( const Quaternion & rhs )
+/***********************************************************
+ * Matrix4f Class Methods
+ **********************************************************/
+Matrix4f::Matrix4f()
 {
-	if( this == &rhs )
+	for( int i = 0; i < 16; i++ )
 	{
-		return *this;
-	}
-	else
-	{
-		w = rhs.w;
-		x = rhs.x;
-		y = rhs.y;
-		z = rhs.z;
-
-		return *this;
+		mElements[i] = 0.0f;
 	}
+	mElements[0] = 1.0f;
+	mElements[5] = 1.0f;
+	mElements[10] = 1.0f;
+	mElements[15] = 1.0f;
 }
 
-// Use this to get info necessary to call glRotatef()
-void Quaternion::getAxisAndAngle( Vector3f & axis, float & angle ) const
+Matrix4f::Matrix4f( const Matrix3f & rotation, const Vector3f & translation )
 {
-	angle = ( acos( w ) * 2.0f ) / PI_OVER_180;    // Convert to degrees
-
-	float scale = sqrt( x * x + y * y + z * z );
-	axis[0] = x / scale;
-	axis[1] = y / scale;
-	axis[2] = z / scale;
+	for( int column = 0; column < 3; column++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			( *this )( row, column ) = rotation( row, column );
+		}
+		( *this )( 3, column ) = 0.0f;
+		( *this )( column, 3 ) = translation[column];
+	}
+	( *this )( 3, 3 ) = 1.0f;
 }
 
-void Quaternion::normalize()
+Matrix4f Matrix4f::operator*( const Matrix4f & rhs ) const
 {
-	float magnitude = sqrt( w * w + x * x + y * y + z * z );
-	w /= magnitude;
-	x /= magnitude;
-	y /= magnitude;
-	z /= magnitude;
+	Matrix4f result;
+	for( int column = 0; column < 4; column++ )
+	{
+		for( int row = 0; row < 4; row++ )
+		{
+			result( row, column ) = ( *this )( row, 0 ) * rhs( 0, column ) +
+			                        ( *this )( row, 1 ) * rhs( 1, column ) +
+			                        ( *this )( row, 2 ) * rhs( 2, column ) +
+			                        ( *this )( row, 3 ) * rhs( 3, column );
+		}
+	}
+	return result;
 }
 
-std::ostream &operator<<( std::ostream & os, const Quaternion & quaternion )
+Matrix4f Matrix4f::transpose() const
 {
-	std::cout << '(' << quaternion.w << ", " << quaternion.x << ", " << quaternion.y << ", " << quaternion.z << ')';
-
-	return os;
+	Matrix4f result;
+	for( int column = 0; column < 4; column++ )
+	{
+		for( int row = 0; row < 4; row++ )
+		{
+			result( row, column ) = ( *this )( column, row );
+		}
+	}
+	return result;
 }
 
-/***********************************************************
- * Plane Class Methods
- **********************************************************/
-Plane::Plane( const Vector3f & normal, const Vector3f & point ) :
-	mNormal( normal )
+// [R | t]^-1 = [R^T | -R^T t]
+Matrix4f Matrix4f::rigidInverse() const
 {
-	mPlaneConstant = normal.dot( point );
+	Matrix3f inverseRotation;
+	for( int column = 0; column < 3; column++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			inverseRotation( row, column ) = ( *this )( column, row );
+		}
+	}
+	Vector3f translation( mElements[12], mElements[13], mElements[14] );
+	return Matrix4f( inverseRotation, -( inverseRotation * translation ) );
 }
 
 /***********************************************************
@@ -186,9 +230,11 @@ Frustum::Frustum() :
 	mNearClip( 0.0f ),
 	mFarClip( 0.0f ),
 	mPosition( Vector3f() ),
-	mOrientation( Quaternion() )
+	mOrientation( Quaternion() ),
+	mCornersAreDirty( true )
 {
-	Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation );
+	Frustum::calculateOrthogonalAxes( mOrthogonalAxes, mOrientation );
+	updateTrigTerms();
 }
 
 Frustum::Frustum( float fovy, float aspectRatio, float nearClip, float farClip, const Vector3f & position, const Quaternion & orientation ) :
@@ -197,28 +243,27 @@ Frustum::Frustum( float fovy, float aspectRatio, float nearClip, float farClip,
 	mNearClip( nearClip ),
 	mFarClip( farClip ),
 	mPosition( position ),
-	mOrientation( orientation )
+	mOrientation( orientation ),
+	mCornersAreDirty( true )
 {
-	Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation );
+	Frustum::calculateOrthogonalAxes( mOrthogonalAxes, mOrientation );
+	updateTrigTerms();
 }
 
 // Works as a "radar" test, see Lighthouse3D.com
 bool Frustum::isPointInFrustum( const Vector3f & aPoint ) const
 {
 	Vector3f point = aPoint - mPosition;    // Translate such that mPosition is origin
-	
-	Vector3f orthogonalAxes[3];
-	calculateOrthogonalAxes( orthogonalAxes, mOrientation );
 
-	float distAlongFrustum = point.dot( orthogonalAxes[0] );
+	float distAlongFrustum = point.dot( mOrthogonalAxes[0] );
 	if( mNearClip <= distAlongFrustum && distAlongFrustum <= mFarClip )
 	{
-		float widthLimit = tan( 0.5 * mHorizFieldOfView * PI_OVER_180 ) * distAlongFrustum;
-		float distAlongWidth = point.dot( orthogonalAxes[1] );
+		float widthLimit = mTanHalfFov * distAlongFrustum;
+		float distAlongWidth = point.dot( mOrthogonalAxes[1] );
 		if( -widthLimit <= distAlongWidth && distAlongWidth <= widthLimit )
 		{
 			float heightLimit = widthLimit * mAspectRatio;
-			float distAlongHeight = point.dot( orthogonalAxes[2] );
+			float distAlongHeight = point.dot( mOrthogonalAxes[2] );
 			if( -heightLimit <= distAlongHeight && distAlongHeight <= heightLimit )
 			{
 				return true;
@@ -229,47 +274,116 @@ bool Frustum::isPointInFrustum( const Vector3f & aPoint ) const
 	return false;
 }
 
-bool Frustum::isSphereInFrustum( const Vector3f & aPoint, float aRadius ) const
+// Just like the point test, except the limits are pushed out by the sphere's radius
+// to see if any of it is inside, and pulled in by it to see if all of it is
+Frustum::Classification Frustum::classifySphere( const Vector3f & center, float radius ) const
+{
+	Classification classification;
+	classifySpheres( &center, &radius, 1, &classification );
+	return classification;
+}
+
+// Branch-free per sphere, so the compiler is free to vectorize the loop
+void Frustum::classifySpheres( const Vector3f * centers, const float * radii, int count, Classification * out ) const
 {
-	float tanAngle = tan( 0.5 * mHorizFieldOfView * PI_OVER_180 );
-	Vector3f point = aPoint - mPosition;
+	Vector3f forward = mOrthogonalAxes[0];
+	Vector3f right = mOrthogonalAxes[1];
+	Vector3f up = mOrthogonalAxes[2];
 
-	Vector3f orthogonalAxes[3];
-	calculateOrthogonalAxes( orthogonalAxes, mOrientation );
+	// Fold the position into the plane offsets, so each sphere is 3 dot products
+	float forwardOffset = mPosition.dot( forward );
+	float rightOffset = mPosition.dot( right );
+	float upOffset = mPosition.dot( up );
 
-	float distAlongFrustum = point.dot( orthogonalAxes[0] );
-	if( mNearClip - aRadius <= distAlongFrustum && distAlongFrustum <= mFarClip + aRadius )
+	for( int i = 0; i < count; i++ )
 	{
-		// Just like point test, except it accounts for the sphere's radius as well
-		float widthLimit = tanAngle * distAlongFrustum + aRadius / cos( 0.5 * mHorizFieldOfView * PI_OVER_180 );
-		float distAlongWidth = point.dot( orthogonalAxes[1] );
-		if( -widthLimit <= distAlongWidth && distAlongWidth <= widthLimit )
+		const Vector3f & center = centers[i];
+		float radius = radii[i];
+
+		float distAlongFrustum = center.dot( forward ) - forwardOffset;
+		float distAlongWidth = fabsf( center.dot( right ) - rightOffset );
+		float distAlongHeight = fabsf( center.dot( up ) - upOffset );
+
+		float widthLimit = mTanHalfFov * distAlongFrustum;
+		float outerWidthLimit = widthLimit + radius * mWidthRadiusScale;
+		float innerWidthLimit = widthLimit - radius * mWidthRadiusScale;
+		float outerHeightLimit = outerWidthLimit * mAspectRatio + radius * mHeightRadiusScale;
+		float innerHeightLimit = innerWidthLimit * mAspectRatio - radius * mHeightRadiusScale;
+
+		bool isOutside = ( distAlongFrustum < mNearClip - radius ) | ( distAlongFrustum > mFarClip + radius ) |
+		                 ( distAlongWidth > outerWidthLimit ) | ( distAlongHeight > outerHeightLimit );
+		bool isInside = ( distAlongFrustum >= mNearClip + radius ) & ( distAlongFrustum <= mFarClip - radius ) &
+		                ( distAlongWidth <= innerWidthLimit ) & ( distAlongHeight <= innerHeightLimit );
+
+		out[i] = isOutside ? OUTSIDE : ( isInside ? INSIDE : INTERSECTING );
+	}
+}
+
+// Each plane is tested against the box corner furthest inside it, found from the
+// box's center and half extents projected onto the plane's normal. The side plane
+// normals aren't normalized, which doesn't matter since only their signs are compared.
+bool Frustum::isAxisAlignedBoxInFrustum( const Vector3f & minCorner, const Vector3f & maxCorner ) const
+{
+	Vector3f center = ( minCorner + maxCorner ) * 0.5f - mPosition;
+	Vector3f halfExtents = ( maxCorner - minCorner ) * 0.5f;
+
+	Vector3f forward = mOrthogonalAxes[0];
+	Vector3f right = mOrthogonalAxes[1];
+	Vector3f up = mOrthogonalAxes[2];
+	float heightTan = mTanHalfFov * mAspectRatio;
+
+	// Outward normals, and each plane's distance from the position along its normal
+	Vector3f normals[6] = { -forward,
+	                        forward,
+	                        right - forward * mTanHalfFov,
+	                        -right - forward * mTanHalfFov,
+	                        up - forward * heightTan,
+	                        -up - forward * heightTan };
+	float offsets[6] = { -mNearClip, mFarClip, 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for( int i = 0; i < 6; i++ )
+	{
+		const Vector3f & normal = normals[i];
+		float projectedRadius = fabsf( normal[0] ) * halfExtents[0] + fabsf( normal[1] ) * halfExtents[1] + fabsf( normal[2] ) * halfExtents[2];
+		if( normal.dot( center ) - projectedRadius > offsets[i] )
 		{
-			float heightLimit = widthLimit * mAspectRatio + aRadius / cos( atan( tanAngle * mAspectRatio ) );
-			float distAlongHeight = point.dot( orthogonalAxes[2] );
-			if( -heightLimit <= distAlongHeight && distAlongHeight <= heightLimit )
-			{
-				return true;
-			}
+			return false;
 		}
 	}
 
-	return false;
+	return true;
 }
 
-void Frustum::calculateCornersAndNormals( Vector3f corners[], Vector3f frustumNormals[], float fovy, float aspectRatio, float nearClip, float farClip, const Vector3f & position, const Quaternion & orientation )
+void Frustum::updateTrigTerms()
 {
-	float nearHalfWidth = tan( 0.5 * fovy * PI_OVER_180 ) * nearClip;
-	float nearHalfHeight = nearHalfWidth / aspectRatio;
-	float farHalfWidth = tan( 0.5 * fovy * PI_OVER_180 ) * farClip;
-	float farHalfHeight = farHalfWidth / aspectRatio;
+	float halfFov = 0.5f * mHorizFieldOfView * PI_OVER_180;
+	mTanHalfFov = mathTan( halfFov );
+	mWidthRadiusScale = 1.0f / mathCos( halfFov );
+	// 1 / cos( atan( u ) ) == sqrt( 1 + u^2 ), which saves two trig calls
+	float heightTan = mTanHalfFov * mAspectRatio;
+	mHeightRadiusScale = sqrtf( 1.0f + heightTan * heightTan );
+}
+
+void Frustum::updateCornersAndNormals() const
+{
+	if( !mCornersAreDirty )
+	{
+		return;
+	}
+	mCornersAreDirty = false;
+
+	float nearHalfWidth = mTanHalfFov * mNearClip;
+	float nearHalfHeight = nearHalfWidth / mAspectRatio;
+	float farHalfWidth = mTanHalfFov * mFarClip;
+	float farHalfHeight = farHalfWidth / mAspectRatio;
 
-	Vector3f orthogonalAxes[3];
-	calculateOrthogonalAxes( orthogonalAxes, orientation );
+	const Vector3f * orthogonalAxes = mOrthogonalAxes;
+	Vector3f * corners = mCorners;
+	Vector3f * frustumNormals = mNormals;
 
 	// Calculate corners
-	Vector3f nearCenter = position + orthogonalAxes[0] * nearClip;    // Center of near clipping plane
-	Vector3f farCenter = position + orthogonalAxes[0] * farClip;    // Center of far clipping plane
+	Vector3f nearCenter = mPosition + orthogonalAxes[0] * mNearClip;    // Center of near clipping plane
+	Vector3f farCenter = mPosition + orthogonalAxes[0] * mFarClip;    // Center of far clipping plane
 
 	corners[NTR] = nearCenter + orthogonalAxes[2] * nearHalfHeight + orthogonalAxes[1] * nearHalfWidth;
 	corners[NTL] = nearCenter + orthogonalAxes[2] * nearHalfHeight - orthogonalAxes[1] * nearHalfWidth;
@@ -294,9 +408,11 @@ void Frustum::calculateCornersAndNormals( Vector3f corners[], Vector3f frustumNo
 
 void Frustum::calculateOrthogonalAxes( Vector3f orthogonalAxes[], const Quaternion & orientation )
 {
-	orthogonalAxes[0] = orientation * Vector3f( 0.0f, 0.0f, -1.0f );
-	orthogonalAxes[1] = orientation * Vector3f( 1.0f, 0.0f, 0.0f );
-	orthogonalAxes[2] = orientation * Vector3f( 0.0f, 1.0f, 0.0f );
+	// The columns of the rotation matrix are the rotated x, y, and z axes
+	Matrix3f rotation( orientation );
+	orthogonalAxes[0] = -rotation.getColumn( 2 );
+	orthogonalAxes[1] = rotation.getColumn( 0 );
+	orthogonalAxes[2] = rotation.getColumn( 1 );
 }
 
 void Frustum::drawWireframe( Vector3f corners[], const Vector3f & color )
@@ -3,34 +3,52 @@
 
 #include <cmath>
 #include <iostream>
+#include <type_traits>
+#include "FastMath.hpp"
 
+#define PI_OVER_180 0.0174532925f
+
+// Above this |dot|, slerp() falls back to nlerp(), since sin(angle) nears 0
+#define SLERP_NLERP_THRESHOLD 0.9995f
+
+// Vector3f, Quaternion and Plane are header-only, with constexpr constructors and
+// defaulted copies, so that temporaries can be inlined and constant-folded in every
+// translation unit, and arrays of them can be copied with memcpy().
 class Vector3f
 {
 	public:
-		Vector3f();
-		Vector3f( float x, float y, float z );
+		constexpr Vector3f() : mComponents{ 0.0f, 0.0f, 0.0f } {};
+		constexpr Vector3f( float x, float y, float z ) : mComponents{ x, y, z } {};
+		Vector3f( const Vector3f & rhs ) = default;
+		Vector3f & operator=( const Vector3f & rhs ) = default;
+
+		// Basis constants, usable at compile time
+		static constexpr Vector3f zero() { return Vector3f( 0.0f, 0.0f, 0.0f ); };
+		static constexpr Vector3f unitX() { return Vector3f( 1.0f, 0.0f, 0.0f ); };
+		static constexpr Vector3f unitY() { return Vector3f( 0.0f, 1.0f, 0.0f ); };
+		static constexpr Vector3f unitZ() { return Vector3f( 0.0f, 0.0f, 1.0f ); };
 
 		float & operator[]( int index ) { return mComponents[index]; };
-		float operator[]( int index ) const { return mComponents[index]; };
+		constexpr float operator[]( int index ) const { return mComponents[index]; };
 
-		Vector3f operator*( float scale ) const { return Vector3f( mComponents[0] * scale, mComponents[1] * scale, mComponents[2] * scale ); };
-		Vector3f operator/( float scale ) const { return Vector3f( mComponents[0] / scale, mComponents[1] / scale, mComponents[2] / scale ); };
-		Vector3f operator+( const Vector3f & rhs ) const { return Vector3f( mComponents[0] + rhs.mComponents[0], mComponents[1] + rhs.mComponents[1], mComponents[2] + rhs.mComponents[2] ); };
-		Vector3f operator-( const Vector3f & rhs ) const { return Vector3f( mComponents[0] - rhs.mComponents[0], mComponents[1] - rhs.mComponents[1], mComponents[2] - rhs.mComponents[2] ); };
-		Vector3f operator-() const { return Vector3f( -mComponents[0], -mComponents[1], -mComponents[2] ); };
+		constexpr Vector3f operator*( float scale ) const { return Vector3f( mComponents[0] * scale, mComponents[1] * scale, mComponents[2] * scale ); };
+		constexpr Vector3f operator/( float scale ) const { return Vector3f( mComponents[0] / scale, mComponents[1] / scale, mComponents[2] / scale ); };
+		constexpr Vector3f operator+( const Vector3f & rhs ) const { return Vector3f( mComponents[0] + rhs.mComponents[0], mComponents[1] + rhs.mComponents[1], mComponents[2] + rhs.mComponents[2] ); };
+		constexpr Vector3f operator-( const Vector3f & rhs ) const { return Vector3f( mComponents[0] - rhs.mComponents[0], mComponents[1] - rhs.mComponents[1], mComponents[2] - rhs.mComponents[2] ); };
+		constexpr Vector3f operator-() const { return Vector3f( -mComponents[0], -mComponents[1], -mComponents[2] ); };
 
-		const Vector3f & operator*=( float scale );
-		const Vector3f & operator/=( float scale );
-		const Vector3f & operator+=( const Vector3f & rhs );
-		const Vector3f & operator-=( const Vector3f & rhs );
+		const Vector3f & operator*=( float scale ) { mComponents[0] *= scale; mComponents[1] *= scale; mComponents[2] *= scale; return *this; };
+		const Vector3f & operator/=( float scale ) { mComponents[0] /= scale; mComponents[1] /= scale; mComponents[2] /= scale; return *this; };
+		const Vector3f & operator+=( const Vector3f & rhs ) { mComponents[0] += rhs.mComponents[0]; mComponents[1] += rhs.mComponents[1]; mComponents[2] += rhs.mComponents[2]; return *this; };
+		const Vector3f & operator-=( const Vector3f & rhs ) { mComponents[0] -= rhs.mComponents[0]; mComponents[1] -= rhs.mComponents[1]; mComponents[2] -= rhs.mComponents[2]; return *this; };
 
 		float magnitude() const { return sqrt( mComponents[0] * mComponents[0] + mComponents[1] * mComponents[1] + mComponents[2] * mComponents[2] ); };
-		float magnitudeSquared() const { return mComponents[0] * mComponents[0] + mComponents[1] * mComponents[1] + mComponents[2] * mComponents[2]; };
-		Vector3f normalize() const;
-		float dot( const Vector3f & rhs ) const { return mComponents[0] * rhs.mComponents[0] + mComponents[1] * rhs.mComponents[1] + mComponents[2] * rhs.mComponents[2]; };
-		Vector3f cross( const Vector3f & rhs ) const { return Vector3f( mComponents[1] * rhs.mComponents[2] - mComponents[2] * rhs.mComponents[1], mComponents[2] * rhs.mComponents[0] - mComponents[0] * rhs.mComponents[2], mComponents[0] * rhs.mComponents[1] - mComponents[1] * rhs.mComponents[0] ); };
+		constexpr float magnitudeSquared() const { return mComponents[0] * mComponents[0] + mComponents[1] * mComponents[1] + mComponents[2] * mComponents[2]; };
+		Vector3f normalize() const { return *this / this->magnitude(); };
+		constexpr float dot( const Vector3f & rhs ) const { return mComponents[0] * rhs.mComponents[0] + mComponents[1] * rhs.mComponents[1] + mComponents[2] * rhs.mComponents[2]; };
+		constexpr Vector3f cross( const Vector3f & rhs ) const { return Vector3f( mComponents[1] * rhs.mComponents[2] - mComponents[2] * rhs.mComponents[1], mComponents[2] * rhs.mComponents[0] - mComponents[0] * rhs.mComponents[2], mComponents[0] * rhs.mComponents[1] - mComponents[1] * rhs.mComponents[0] ); };
 
-		friend std::ostream &operator<<( std::ostream & os, const Vector3f & vector );
+		friend std::ostream &operator<<( std::ostream & os, const Vector3f & vector ) { os << '(' << vector[0] << ", " << vector[1] << ", " << vector[2] << ')'; return os; };
 
 	private:
 		float mComponents[3];
@@ -39,42 +57,123 @@ class Vector3f
 class Quaternion
 {
 	public:
-		Quaternion();
-		Quaternion( float W, float X, float Y, float Z );
+		constexpr Quaternion() : w( 1.0f ), x( 0.0f ), y( 0.0f ), z( 0.0f ) {};    // Already normalized
+		Quaternion( float W, float X, float Y, float Z ) : w( W ), x( X ), y( Y ), z( Z ) { this->normalize(); };
 		Quaternion( const Vector3f & axis, float angle );
-		~Quaternion();
+		Quaternion( const Quaternion & rhs ) = default;
+		Quaternion & operator=( const Quaternion & rhs ) = default;
+
+		static constexpr Quaternion identity() { return Quaternion(); };
 
 		Quaternion operator*( const Quaternion & rhs ) const { return Quaternion( w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z, w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y, w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x, w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w ); };
 		// Multiplying a quaternion q with a vector v applies the q-rotation to v
 		// To apply a quaternion-rotation to a vector, you need to multiply the
 		// vector by the quaternion and its conjugate
 		Vector3f operator*( const Vector3f & vector ) const;
-		Quaternion & operator=( const Quaternion & rhs );
+		// Same rotation as above without normalizing the vector first, so its length is kept.
+		// Uses v + 2w(q x v) + 2q x (q x v), where q is the vector part, which is much cheaper
+		// than the two quaternion products. Relies on this quaternion being normalized.
+		Vector3f rotate( const Vector3f & vector ) const { Vector3f axis( x, y, z ); Vector3f twiceCross = axis.cross( vector ) * 2.0f; return vector + twiceCross * w + axis.cross( twiceCross ); };
 		// Use this to get info necessary to call glRotatef()
 		void getAxisAndAngle( Vector3f & axis, float & angle ) const;
 
-		void normalize();
-		Quaternion getConjugate() const { return Quaternion( w, -x, -y, -z ); };
+		void normalize() { float inverseMagnitude = mathInverseSqrt( w * w + x * x + y * y + z * z ); w *= inverseMagnitude; x *= inverseMagnitude; y *= inverseMagnitude; z *= inverseMagnitude; };
+		// 4D dot product, |dot| is 1 for identical rotations
+		constexpr float dot( const Quaternion & rhs ) const { return w * rhs.w + x * rhs.x + y * rhs.y + z * rhs.z; };
+		// The conjugate of a normalized quaternion is already normalized
+		constexpr Quaternion getConjugate() const { return Quaternion( w, -x, -y, -z, AlreadyNormalized() ); };
 
-		friend std::ostream &operator<<( std::ostream & os, const Quaternion & quaternion );
+		// Interpolation between two orientations, t in [0, 1]. All of them take the
+		// shortest path, flipping to if the two are more than 180 degrees apart.
+		// nlerp() is cheapest, but its angular speed isn't constant over t.
+		static Quaternion nlerp( const Quaternion & from, const Quaternion & to, float t );
+		// Constant angular speed, at the cost of an acos() and three sin()'s
+		static Quaternion slerp( const Quaternion & from, const Quaternion & to, float t );
+		// nlerp() with t corrected by a polynomial fitted to slerp(), so it tracks slerp()
+		// to within about 0.07 degrees but costs little more than nlerp()
+		static Quaternion slerpFast( const Quaternion & from, const Quaternion & to, float t );
+		// slerpFast() over whole arrays, 4 quaternions at a time with SSE. Used to
+		// interpolate every body between the last two physics steps before rendering.
+		static void slerpFast( const Quaternion * from, const Quaternion * to, float t, Quaternion * out, int count );
+
+		friend std::ostream &operator<<( std::ostream & os, const Quaternion & quaternion ) { os << '(' << quaternion.w << ", " << quaternion.x << ", " << quaternion.y << ", " << quaternion.z << ')'; return os; };
+		friend class Matrix3f;
+		friend class PackedQuaternion;
 	
 	private:
+		// Skips normalizing, so it can be used at compile time
+		struct AlreadyNormalized {};
+		constexpr Quaternion( float W, float X, float Y, float Z, AlreadyNormalized ) : w( W ), x( X ), y( Y ), z( Z ) {};
+
 		float w;
 		float x;
 		float y;
 		float z;
 };
 
+// Matrices are stored column-major, the same as OpenGL expects them
+class Matrix3f
+{
+	public:
+		Matrix3f();    // Identity
+		// Rotation matrix equivalent to the quaternion, in one pass with no trig or sqrt
+		Matrix3f( const Quaternion & rotation );
+
+		float & operator()( int row, int column ) { return mElements[column * 3 + row]; };
+		float operator()( int row, int column ) const { return mElements[column * 3 + row]; };
+		// For a rotation matrix these are the rotated x, y and z axes
+		Vector3f getColumn( int column ) const { return Vector3f( mElements[column * 3], mElements[column * 3 + 1], mElements[column * 3 + 2] ); };
+
+		Vector3f operator*( const Vector3f & vector ) const { return Vector3f( mElements[0] * vector[0] + mElements[3] * vector[1] + mElements[6] * vector[2], mElements[1] * vector[0] + mElements[4] * vector[1] + mElements[7] * vector[2], mElements[2] * vector[0] + mElements[5] * vector[1] + mElements[8] * vector[2] ); };
+		Matrix3f operator*( const Matrix3f & rhs ) const;
+
+		// For a rotation matrix, this is also the inverse
+		Matrix3f transpose() const;
+
+	private:
+		float mElements[9];
+};
+
+class Matrix4f
+{
+	public:
+		Matrix4f();    // Identity
+		// Rigid transform, rotates and then translates
+		Matrix4f( const Matrix3f & rotation, const Vector3f & translation );
+
+		float & operator()( int row, int column ) { return mElements[column * 4 + row]; };
+		float operator()( int row, int column ) const { return mElements[column * 4 + row]; };
+		// Pass to glLoadMatrixf() or glMultMatrixf()
+		const float * getData() const { return mElements; };
+
+		// Treats the vector as a point, w = 1
+		Vector3f transformPoint( const Vector3f & point ) const { return Vector3f( mElements[0] * point[0] + mElements[4] * point[1] + mElements[8] * point[2] + mElements[12], mElements[1] * point[0] + mElements[5] * point[1] + mElements[9] * point[2] + mElements[13], mElements[2] * point[0] + mElements[6] * point[1] + mElements[10] * point[2] + mElements[14] ); };
+		// Treats the vector as a direction, w = 0
+		Vector3f transformVector( const Vector3f & vector ) const { return Vector3f( mElements[0] * vector[0] + mElements[4] * vector[1] + mElements[8] * vector[2], mElements[1] * vector[0] + mElements[5] * vector[1] + mElements[9] * vector[2], mElements[2] * vector[0] + mElements[6] * vector[1] + mElements[10] * vector[2] ); };
+		Matrix4f operator*( const Matrix4f & rhs ) const;
+
+		Matrix4f transpose() const;
+		// Inverse of a rotation plus translation, using the transpose of the rotation
+		Matrix4f rigidInverse() const;
+
+	private:
+		float mElements[16];
+};
+
 class Plane
 {
 	public:
-		Plane( const Vector3f & normal, const Vector3f & point );
+		constexpr Plane() : mNormal( 0.0f, 0.0f, 0.0f ), mPlaneConstant( 0.0f ) {};
+		constexpr Plane( const Vector3f & normal, const Vector3f & point ) : mNormal( normal ), mPlaneConstant( normal.dot( point ) ) {};
 
-		Vector3f getNormal() const { return mNormal; };
+		constexpr Vector3f getNormal() const { return mNormal; };
+		constexpr float getConstant() const { return mPlaneConstant; };
 
-		bool isInPositiveHalfSpace( const Vector3f & point ) const { return ( mNormal.dot( point ) > mPlaneConstant ); };
-		bool isInNegativeHalfSpace( const Vector3f & point ) const { return ( mNormal.dot( point ) < mPlaneConstant ); };
-		bool isInPlane( const Vector3f & point ) const { return ( mNormal.dot( point ) == mPlaneConstant ); }
+		constexpr bool isInPositiveHalfSpace( const Vector3f & point ) const { return ( mNormal.dot( point ) > mPlaneConstant ); };
+		constexpr bool isInNegativeHalfSpace( const Vector3f & point ) const { return ( mNormal.dot( point ) < mPlaneConstant ); };
+		constexpr bool isInPlane( const Vector3f & point ) const { return ( mNormal.dot( point ) == mPlaneConstant ); }
+		// Signed distance along the normal, scaled by the normal's length if it isn't normalized
+		constexpr float distanceTo( const Vector3f & point ) const { return mNormal.dot( point ) - mPlaneConstant; };
 
 	private:
 		Vector3f mNormal;
@@ -87,8 +186,23 @@ class Frustum
 		Frustum();
 		Frustum( float fovy, float aspectRatio, float nearClip, float farClip, const Vector3f & position, const Quaternion & orientation );
 
+		enum Classification
+		{
+			OUTSIDE,
+			INTERSECTING,
+			INSIDE
+		};
+
 		bool isPointInFrustum( const Vector3f & aPoint ) const;
-		bool isSphereInFrustum( const Vector3f & aPoint, float aRadius ) const;
+		bool isSphereInFrustum( const Vector3f & aPoint, float aRadius ) const { return classifySphere( aPoint, aRadius ) != OUTSIDE; };
+		// Same test as isSphereInFrustum(), but also tells apart spheres entirely inside
+		Classification classifySphere( const Vector3f & center, float radius ) const;
+		// Classifies count spheres at once, e.g. every object in the scene. Uses only the
+		// cached basis and trig terms, so each sphere costs a few multiply-adds.
+		void classifySpheres( const Vector3f * centers, const float * radii, int count, Classification * out ) const;
+		// Axis aligned box test against the same four side planes the sphere test uses, plus near
+		// and far. Conservative: a box near a corner of the frustum may pass while being outside.
+		bool isAxisAlignedBoxInFrustum( const Vector3f & minCorner, const Vector3f & maxCorner ) const;
 
 		float getFov() const { return mHorizFieldOfView; };
 		float getAspectRatio() const { return mAspectRatio; };
@@ -96,17 +210,18 @@ class Frustum
 		float getFarClip() const { return mFarClip; };
 		Vector3f getPosition() const { return mPosition; };
 		Quaternion getOrientation() const { return mOrientation; };
-		const Vector3f * getCorners() const { return mCorners; };
-		const Vector3f * getNormals() const { return mNormals; };
+		// Corners and normals are only recalculated when asked for after a setter has changed them
+		const Vector3f * getCorners() const { updateCornersAndNormals(); return mCorners; };
+		const Vector3f * getNormals() const { updateCornersAndNormals(); return mNormals; };
 
-		void setFov( float horizontalFov ) { mHorizFieldOfView = horizontalFov; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
-		void setAspectRatio( float aspectRatio ) { mAspectRatio = aspectRatio; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
-		void setNearClip( float nearClip ) { mNearClip = nearClip; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
-		void setFarClip( float farClip ) { mFarClip = farClip; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
-		void setPosition( const Vector3f & position ) { mPosition = position; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
-		void setOrientation( const Quaternion & orientation ) { mOrientation = orientation; Frustum::calculateCornersAndNormals( mCorners, mNormals, mHorizFieldOfView, mAspectRatio, mNearClip, mFarClip, mPosition, mOrientation ); };
+		void setFov( float horizontalFov ) { mHorizFieldOfView = horizontalFov; updateTrigTerms(); mCornersAreDirty = true; };
+		void setAspectRatio( float aspectRatio ) { mAspectRatio = aspectRatio; updateTrigTerms(); mCornersAreDirty = true; };
+		void setNearClip( float nearClip ) { mNearClip = nearClip; mCornersAreDirty = true; };
+		void setFarClip( float farClip ) { mFarClip = farClip; mCornersAreDirty = true; };
+		void setPosition( const Vector3f & position ) { mPosition = position; mCornersAreDirty = true; };
+		void setOrientation( const Quaternion & orientation ) { mOrientation = orientation; Frustum::calculateOrthogonalAxes( mOrthogonalAxes, mOrientation ); mCornersAreDirty = true; };
 
-		void draw( const Vector3f & color ) { drawWireframe( mCorners, color ); };
+		void draw( const Vector3f & color ) { updateCornersAndNormals(); drawWireframe( mCorners, color ); };
 
 		enum Corner
 		{
@@ -130,7 +245,9 @@ class Frustum
 		};
 
 	private:
-		static void calculateCornersAndNormals( Vector3f corners[], Vector3f frustumNormals[], float fovy, float aspectRatio, float nearClip, float farClip, const Vector3f & position, const Quaternion & orientation );
+		// Recomputes the tan/cos terms from the FOV and aspect ratio
+		void updateTrigTerms();
+		void updateCornersAndNormals() const;
 		// 0 --> Forward
 		// 1 --> Right
 		// 2 --> Up
@@ -145,8 +262,118 @@ class Frustum
 		Vector3f   mPosition;
 		Quaternion mOrientation;
 
-		Vector3f mCorners[8];
-		Vector3f mNormals[6];
+		// Cached from the above by the setters
+		Vector3f mOrthogonalAxes[3];
+		float    mTanHalfFov;
+		float    mWidthRadiusScale;     // 1 / cos( half FOV ), how much a sphere's radius widens the width limit
+		float    mHeightRadiusScale;    // Same for the height limit
+
+		// Filled in lazily by updateCornersAndNormals(), so a const Frustum can still hand them out
+		mutable Vector3f mCorners[8];
+		mutable Vector3f mNormals[6];
+		mutable bool     mCornersAreDirty;
 };
 
+/***********************************************************
+ * Quaternion Class Methods
+ **********************************************************/
+inline Quaternion::Quaternion( const Vector3f & axis, float angle )
+{
+	angle *= PI_OVER_180;
+	angle *= 0.5f;
+
+	float s = mathSin( angle );
+
+	Vector3f normalAxis = axis.normalize();
+
+	w = mathCos( angle );
+	x = normalAxis[0] * s;
+	y = normalAxis[1] * s;
+	z = normalAxis[2] * s;
+
+	this->normalize();
+}
+
+// Multiplying a quaternion q with a vector v applies the q-rotation to v
+// To apply a quaternion-rotation to a vector, you need to multiply the
+// vector by the quaternion and its conjugate
+inline Vector3f Quaternion::operator*( const Vector3f & vector ) const
+{
+	Vector3f normalizedVector = vector.normalize();
+ 
+	Quaternion vectorQuaternion( 0.0f, normalizedVector[0], normalizedVector[1], normalizedVector[2], AlreadyNormalized() );
+ 
+	Quaternion resultQuaternion = *this * ( vectorQuaternion * getConjugate() );
+ 
+	return Vector3f( resultQuaternion.x, resultQuaternion.y, resultQuaternion.z );
+}
+
+// Use this to get info necessary to call glRotatef()
+inline void Quaternion::getAxisAndAngle( Vector3f & axis, float & angle ) const
+{
+	angle = ( acos( w ) * 2.0f ) / PI_OVER_180;    // Convert to degrees
+
+	float scale = sqrt( x * x + y * y + z * z );
+	axis[0] = x / scale;
+	axis[1] = y / scale;
+	axis[2] = z / scale;
+}
+
+inline Quaternion Quaternion::nlerp( const Quaternion & from, const Quaternion & to, float t )
+{
+	// q and -q are the same rotation, pick the one closer to from
+	float toWeight = from.dot( to ) < 0.0f ? -t : t;
+	float fromWeight = 1.0f - t;
+
+	return Quaternion( from.w * fromWeight + to.w * toWeight,
+	                   from.x * fromWeight + to.x * toWeight,
+	                   from.y * fromWeight + to.y * toWeight,
+	                   from.z * fromWeight + to.z * toWeight );
+}
+
+inline Quaternion Quaternion::slerp( const Quaternion & from, const Quaternion & to, float t )
+{
+	float cosAngle = from.dot( to );
+	float sign = 1.0f;
+	if( cosAngle < 0.0f )
+	{
+		cosAngle = -cosAngle;
+		sign = -1.0f;
+	}
+
+	if( cosAngle > SLERP_NLERP_THRESHOLD )
+	{
+		return Quaternion::nlerp( from, to, t );
+	}
+
+	float angle = acosf( cosAngle );
+	float inverseSin = 1.0f / mathSin( angle );
+	float fromWeight = mathSin( ( 1.0f - t ) * angle ) * inverseSin;
+	float toWeight = sign * mathSin( t * angle ) * inverseSin;
+
+	// Still renormalized, to keep rounding from building up over many frames
+	return Quaternion( from.w * fromWeight + to.w * toWeight,
+	                   from.x * fromWeight + to.x * toWeight,
+	                   from.y * fromWeight + to.y * toWeight,
+	                   from.z * fromWeight + to.z * toWeight );
+}
+
+// nlerp() runs fast in the middle of the arc and slow at the ends. Bending t by
+// t(t - 0.5)(t - 1)k, with k depending on how far apart the two are, cancels most of that.
+// Coefficients are from Arseny Kapoulkine's "Approximating slerp".
+inline Quaternion Quaternion::slerpFast( const Quaternion & from, const Quaternion & to, float t )
+{
+	float d = fabsf( from.dot( to ) );
+	float a = 1.0904f + d * ( -3.2452f + d * ( 3.55645f - d * 1.43519f ) );
+	float b = 0.848013f + d * ( -1.06021f + d * 0.215638f );
+	float k = a * ( t - 0.5f ) * ( t - 0.5f ) + b;
+	float correctedT = t + t * ( t - 0.5f ) * ( t - 1.0f ) * k;
+
+	return Quaternion::nlerp( from, to, correctedT );
+}
+
+static_assert( std::is_trivially_copyable<Vector3f>::value, "Vector3f should be trivially copyable" );
+static_assert( std::is_trivially_copyable<Quaternion>::value, "Quaternion should be trivially copyable" );
+static_assert( std::is_trivially_copyable<Plane>::value, "Plane should be trivially copyable" );
+
 #endif
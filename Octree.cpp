@@ -17,6 +17,8 @@ void Octree::initializeNode( OctreeNode * const node, const Vector3f & minCorner
     node->hasChildren = false;
     node->numBoxes = 0;
     node->depth = depth;
+    node->layers = 0;
+    node->masks = 0;
 }
 
 void Octree::createChildren( OctreeNode * const node )
@@ -47,11 +49,11 @@ void Octree::createChildren( OctreeNode * const node )
     // It's number of boxes is incremented each call to insertBox(), so it will be basically
     // no change to the numBoxes field
     node->numBoxes = 0;
-    for( std::set<OrientedBoundingBox *>::iterator it = node->boxes.begin();
+    for( BoxMap::iterator it = node->boxes.begin();
          it != node->boxes.end();
          ++it )
     {
-        insertBox( *it, node );
+        insertBox( it->first, it->second, node );
     }
     node->boxes.clear();
 }
@@ -59,7 +61,7 @@ void Octree::createChildren( OctreeNode * const node )
 // Insert the box into the appropriate node in the octree
 // Will create children if necessary, and insert the box in the
 // appropriate child(ren)
-void Octree::insertBox( OrientedBoundingBox * const box, OctreeNode * const node )
+void Octree::insertBox( OrientedBoundingBox * const box, const CollisionFilter & filter, OctreeNode * const node )
 {
     // If this node has no children, but can, create its children
     if( !node->hasChildren &&
@@ -124,7 +126,7 @@ void Octree::insertBox( OrientedBoundingBox * const box, OctreeNode * const node
                     }
 
                     // Add the box to the appropriate child
-                    insertBox( box, node->children[x][y][z] );
+                    insertBox( box, filter, node->children[x][y][z] );
                 }
             }
         }
@@ -132,10 +134,12 @@ void Octree::insertBox( OrientedBoundingBox * const box, OctreeNode * const node
     // If it has no children, just add to the node's set of boxes
     else
     {
-        node->boxes.insert( box );
+        node->boxes[box] = filter;
     }
 
     node->numBoxes++;
+    node->layers |= filter.layer;
+    node->masks |= filter.mask;
 }
 
 // Removes the box from this node, helper function for public version
@@ -213,9 +217,41 @@ void Octree::removeBox( OrientedBoundingBox * const box, OctreeNode * const node
     {
         node->boxes.erase( box );
     }
+
+    updateFilterUnion( node );
 }
 
-void Octree::collectBoxesFromChildren( const OctreeNode * const node, std::set<OrientedBoundingBox *> & collectedBoxes )
+void Octree::updateFilterUnion( OctreeNode * const node )
+{
+    node->layers = 0;
+    node->masks = 0;
+    if( node->hasChildren )
+    {
+        for( int x = 0; x < 2; x++ )
+        {
+            for( int y = 0; y < 2; y++ )
+            {
+                for( int z = 0; z < 2; z++ )
+                {
+                    node->layers |= node->children[x][y][z]->layers;
+                    node->masks |= node->children[x][y][z]->masks;
+                }
+            }
+        }
+    }
+    else
+    {
+        for( BoxMap::const_iterator it = node->boxes.begin();
+             it != node->boxes.end();
+             ++it )
+        {
+            node->layers |= it->second.layer;
+            node->masks |= it->second.mask;
+        }
+    }
+}
+
+void Octree::collectBoxesFromChildren( const OctreeNode * const node, BoxMap & collectedBoxes )
 {
     // Recurse on children
     if( node->hasChildren )
@@ -232,7 +268,7 @@ void Octree::collectBoxesFromChildren( const OctreeNode * const node, std::set<O
     // For leaf nodes
     else
     {
-        for( std::set<OrientedBoundingBox *>::iterator it = node->boxes.begin();
+        for( BoxMap::const_iterator it = node->boxes.begin();
              it != node->boxes.end();
              ++it )
         {
@@ -258,11 +294,11 @@ void Octree::collectBoxesFromChildren( const OctreeNode * const node, std::vecto
     // For leaf nodes
     else
     {
-        for( std::set<OrientedBoundingBox *>::iterator it = node->boxes.begin();
+        for( BoxMap::const_iterator it = node->boxes.begin();
              it != node->boxes.end();
              ++it )
         {
-            collectedBoxes.push_back( *it );
+            collectedBoxes.push_back( it->first );
         }
     }
 }
@@ -307,6 +343,12 @@ void Octree::destroyOctreeNode( OctreeNode *& node )
 
 void Octree::getPotentialCollisionPairs( const OctreeNode * const node, std::vector<BoxPair> & pairs )
 {
+    // No box down here is on a layer that any box down here collides with
+    if( ( node->layers & node->masks ) == 0 )
+    {
+        return;
+    }
+
     if( node->hasChildren )
     {
         getPotentialCollisionPairs( node->children[0][0][0], pairs );
@@ -320,25 +362,99 @@ void Octree::getPotentialCollisionPairs( const OctreeNode * const node, std::vec
     }
     else
     {
+		// Nothing in here is moving, so none of its pairs can have changed
+		bool hasAwakeBox = false;
+		for( BoxMap::const_iterator it = node->boxes.begin();
+			 it != node->boxes.end();
+			 ++it )
+		{
+			if( !it->first->isAsleep() )
+			{
+				hasAwakeBox = true;
+				break;
+			}
+		}
+		if( !hasAwakeBox )
+		{
+			return;
+		}
+
 		BoxPair pair;
 		int i = 0;    // Loop control to make sure we don't check too many pairs
-		for( std::set<OrientedBoundingBox *>::const_iterator it = node->boxes.begin();
+		for( BoxMap::const_iterator it = node->boxes.begin();
 			 i < node->numBoxes - 1;
 			 i++ )
 		{
-			std::set<OrientedBoundingBox *>::const_iterator temp = it;
-			for( std::set<OrientedBoundingBox *>::const_iterator it2 = ++it;
+			BoxMap::const_iterator temp = it;
+			for( BoxMap::const_iterator it2 = ++it;
 				 it2 != node->boxes.end();
 				 ++it2 )
 			{
-				pair.box1 = *temp;
-				pair.box2 = *it2;
+				if( temp->first->isAsleep() && it2->first->isAsleep() )
+				{
+					continue;
+				}
+				// Filtered out, each box has to be on a layer the other collides with
+				if( ( temp->second.layer & it2->second.mask ) == 0 || ( it2->second.layer & temp->second.mask ) == 0 )
+				{
+					continue;
+				}
+				pair.box1 = temp->first;
+				pair.box2 = it2->first;
 				pairs.push_back( pair );
 			}
 		}
     }
 }
 
+void Octree::getBoxesWithinSphere( const OctreeNode * const node, const Vector3f & center, float radius, std::set<OrientedBoundingBox *> & boxes )
+{
+	// Distance from the sphere's center to the closest point of the node
+	float distanceSquared = 0.0f;
+	for( int i = 0; i < 3; i++ )
+	{
+		if( center[i] < node->minCorner[i] )
+		{
+			distanceSquared += ( node->minCorner[i] - center[i] ) * ( node->minCorner[i] - center[i] );
+		}
+		else if( center[i] > node->maxCorner[i] )
+		{
+			distanceSquared += ( center[i] - node->maxCorner[i] ) * ( center[i] - node->maxCorner[i] );
+		}
+	}
+
+	// Sphere doesn't touch this node, so none of its boxes can be hit
+	if( distanceSquared > radius * radius )
+	{
+		return;
+	}
+
+	if( node->hasChildren )
+	{
+		getBoxesWithinSphere( node->children[0][0][0], center, radius, boxes );
+		getBoxesWithinSphere( node->children[0][0][1], center, radius, boxes );
+		getBoxesWithinSphere( node->children[0][1][0], center, radius, boxes );
+		getBoxesWithinSphere( node->children[0][1][1], center, radius, boxes );
+		getBoxesWithinSphere( node->children[1][0][0], center, radius, boxes );
+		getBoxesWithinSphere( node->children[1][0][1], center, radius, boxes );
+		getBoxesWithinSphere( node->children[1][1][0], center, radius, boxes );
+		getBoxesWithinSphere( node->children[1][1][1], center, radius, boxes );
+	}
+	else
+	{
+		for( BoxMap::const_iterator it = node->boxes.begin();
+			 it != node->boxes.end();
+			 ++it )
+		{
+			float minDistance = radius + it->first->getRadius();
+			if( ( it->first->getCenter() - center ).magnitudeSquared() <= minDistance * minDistance )
+			{
+				boxes.insert( it->first );
+			}
+		}
+	}
+}
+
 void Octree::getBoxesWithinFrustum( const OctreeNode * const node, const Frustum & frustum, std::vector<OrientedBoundingBox *> & visibleBoxes )
 {
 	int status = -1;                // Assume inside; -1 = inside, 0 = outside; 1 = intersect
@@ -435,11 +551,11 @@ void Octree::getBoxesWithinFrustum( const OctreeNode * const node, const Frustum
 		}
 		else
 		{
-			for( std::set<OrientedBoundingBox *>::iterator it = node->boxes.begin();
+			for( BoxMap::const_iterator it = node->boxes.begin();
 				 it != node->boxes.end();
 				 ++it )
 			{
-				visibleBoxes.push_back( *it );
+				visibleBoxes.push_back( it->first );
 			}
 		}
 	}
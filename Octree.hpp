@@ -4,6 +4,7 @@
 #include "Math.hpp"
 #include "OrientedBoundingBox.hpp"
 #include <iostream>
+#include <map>
 #include <set>    // Akin to STL vector class
 #include <vector>
 #include "GL/glut.h"
@@ -12,6 +13,9 @@
 #define MIN_ELEMENTS_PER_OCTREE 3
 #define MAX_ELEMENTS_PER_OCTREE 6
 
+// Boxes added without a filter are on every layer and collide with every layer
+#define ALL_COLLISION_LAYERS 0xFFFFFFFF
+
 // Used for grouping possible collision pairs
 struct BoxPair
 {
@@ -19,19 +23,34 @@ struct BoxPair
     OrientedBoundingBox * box2;
 };
 
+// Which layers a box is on, and which layers it collides with. Two boxes are only
+// paired up if each one's layer is in the other's mask.
+struct CollisionFilter
+{
+    unsigned int layer;
+    unsigned int mask;
+};
+
 class Octree
 {
     public:
         Octree( const Vector3f & minCorner, const Vector3f & maxCorner );
         ~Octree() { destroyOctreeNode( mRoot ); };
 
-        void addBox( OrientedBoundingBox * box ) { insertBox( box, mRoot ); };
+        // To change the filter of a box, remove it and add it back
+        void addBox( OrientedBoundingBox * box, unsigned int layer = ALL_COLLISION_LAYERS, unsigned int mask = ALL_COLLISION_LAYERS ) { CollisionFilter filter = { layer, mask }; insertBox( box, filter, mRoot ); };
         void removeBox( OrientedBoundingBox * box ) { removeBox( box, mRoot ); };
         void getPotentialCollisionPairs( std::vector<BoxPair> & pairs ) const { getPotentialCollisionPairs( mRoot, pairs ); };
         void getBoxesWithinFrustum( const Frustum & frustum, std::vector<OrientedBoundingBox *> & visibleBoxes ) { getBoxesWithinFrustum( mRoot, frustum, visibleBoxes ); };
+        // Broadphase for OrientedBoundingBox::sweptCollisionWith(). Collects every box that could be
+        // hit by box as it moves along velocity, by bounding the swept sphere with one bigger sphere.
+        // The box itself is included if it has been added to the tree.
+        void getBoxesAlongSweep( const OrientedBoundingBox & box, const Vector3f & velocity, std::set<OrientedBoundingBox *> & candidates ) const { getBoxesWithinSphere( mRoot, box.getCenter() + velocity * 0.5f, box.getRadius() + velocity.magnitude() * 0.5f, candidates ); };
         void draw( Vector3f color ) const { glPolygonMode( GL_FRONT_AND_BACK, GL_LINE ); drawNodeAndChildren( mRoot, color ); glPolygonMode( GL_FRONT_AND_BACK, GL_FILL ); };
 
     private:
+        typedef std::map<OrientedBoundingBox *, CollisionFilter> BoxMap;
+
         // One eighth of the space. Each level has 8 of these, hence octree.
         struct OctreeNode
         {
@@ -44,7 +63,12 @@ class Octree
 
             int depth;
             int numBoxes;    // Sum of boxes in this node and all below it
-            std::set<OrientedBoundingBox *> boxes;
+            BoxMap boxes;
+
+            // OR of the layers and masks of all boxes in this node and all below it.
+            // If they have no bits in common no pair down here can pass the filter.
+            unsigned int layers;
+            unsigned int masks;
         };
 
         // Initializes an allocated node to have no boxes, no children, etc.
@@ -53,13 +77,15 @@ class Octree
         // based on their position
         static void createChildren( OctreeNode * const node );
         // Insert the box into the appropriate node in the octree. Helper for addBox()
-        static void insertBox( OrientedBoundingBox * const box, OctreeNode * const node );
+        static void insertBox( OrientedBoundingBox * const box, const CollisionFilter & filter, OctreeNode * const node );
         // Remove the box from this node in the octree. Helper for public removeBox()
         static void removeBox( OrientedBoundingBox * const box, OctreeNode * const node );
-        // Collect the boxes of the children of this node into the set
-        static void collectBoxesFromChildren( const OctreeNode * const node, std::set<OrientedBoundingBox *> & collectedBoxes );
+        // Collect the boxes of the children of this node, along with their filters, into the map
+        static void collectBoxesFromChildren( const OctreeNode * const node, BoxMap & collectedBoxes );
 		// Collect the boxes of the children of this node into the set
         static void collectBoxesFromChildren( const OctreeNode * const node, std::vector<OrientedBoundingBox *> & collectedBoxes );
+        // Recalculate the layer and mask unions of this node after a box was removed
+        static void updateFilterUnion( OctreeNode * const node );
         // Destroy the children of this node, and collect all their boxes into this node
         static void collapseChildren( OctreeNode * const node );
         // Deallocate all of the nodes in the tree below and including this one.
@@ -67,6 +93,8 @@ class Octree
 
         // Populates the vector with potential collision pairs
         static void getPotentialCollisionPairs( const OctreeNode * const node, std::vector<BoxPair> & pairs );
+        // Populates the set with boxes whose bounding spheres intersect the sphere
+        static void getBoxesWithinSphere( const OctreeNode * const node, const Vector3f & center, float radius, std::set<OrientedBoundingBox *> & boxes );
         // Populates vector with boxes that are enclosed in or intersect the frustum
         static void getBoxesWithinFrustum( const OctreeNode * const node, const Frustum & frustum, std::vector<OrientedBoundingBox *> & visibleBoxes );
 
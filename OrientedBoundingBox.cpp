@@ -1,6 +1,7 @@
 #include "OrientedBoundingBox.hpp"
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
 #include <GL/glut.h>
 
 #define PI_OVER_180 0.0174532925f
@@ -9,7 +10,11 @@ OrientedBoundingBox::OrientedBoundingBox() :
     mCenter( Vector3f( 0.0f, 0.0f, 0.0f ) ),
     mEdgeHalfLengths( Vector3f( 1.0f, 1.0f, 1.0f ) ),
     mOrientation( Quaternion() ),
-    mHasCollided( false )
+    mHasCollided( false ),
+    mIsAsleep( false ),
+    mFramesAtRest( 0 ),
+    mRestCenter( mCenter ),
+    mRestOrientation( mOrientation )
 {
     this->calculateRadius();
 }
@@ -18,7 +23,11 @@ OrientedBoundingBox::OrientedBoundingBox( const Vector3f & center, const Vector3
     mCenter( center ),
     mEdgeHalfLengths( edgeHalfLengths ),
     mOrientation( orientation ),
-    mHasCollided( false )
+    mHasCollided( false ),
+    mIsAsleep( false ),
+    mFramesAtRest( 0 ),
+    mRestCenter( mCenter ),
+    mRestOrientation( mOrientation )
 {
     this->calculateRadius();
 }
@@ -30,6 +39,24 @@ void OrientedBoundingBox::rotate( const Vector3f & axis, float degrees )
 	mOrientation = mOrientation * deltaRotation;
 }
 
+// Compare against where the box came to rest rather than last frame, so that
+// a slow drift still adds up to a movement eventually
+bool OrientedBoundingBox::updateRestState()
+{
+	float distanceSquared = ( mCenter - mRestCenter ).magnitudeSquared();
+	float rotation = 1.0f - fabs( mOrientation.dot( mRestOrientation ) );
+	if( distanceSquared > SLEEP_LINEAR_THRESHOLD * SLEEP_LINEAR_THRESHOLD || rotation > SLEEP_ANGULAR_THRESHOLD )
+	{
+		mRestCenter = mCenter;
+		mRestOrientation = mOrientation;
+		mFramesAtRest = 0;
+		return true;
+	}
+
+	mFramesAtRest++;
+	return false;
+}
+
 bool OrientedBoundingBox::isPointInside( const Vector3f & point ) const
 {
     // Transform the point so that the center of this box is the origin
@@ -54,43 +81,14 @@ bool OrientedBoundingBox::isPointInside( const Vector3f & point ) const
 
 // Use the separating plane theorem to test whether two oriented bounding boxes
 // intersect. If they do, then we have a collision
-bool OrientedBoundingBox::collisionWith( const OrientedBoundingBox & otherBox ) const
+bool OrientedBoundingBox::collisionWith( const OrientedBoundingBox & otherBox, int & separatingAxis ) const
 {
-    // First do a sphere check, will save A LOT of time if the boxes are close but not touching
-    // Try taking this out and seeing how dramatically it slows down
-    // We're also saving a sqrt() by calling magnitudeSquared()
-    float minCollisionDistance = otherBox.mRadius + mRadius;
-    if( ( otherBox.mCenter - mCenter ).magnitudeSquared() > ( minCollisionDistance * minCollisionDistance ) )
+    SeparatingAxisSetup setup;
+    if( !prepareSeparatingAxisTest( otherBox, setup ) )
     {
         return false;
     }
 
-    Vector3f thisCorners[8];
-    Vector3f otherCorners[8];
-    Vector3f thisOrthogonalAxes[3];
-    Vector3f otherOrthogonalAxes[3];
-
-    OrientedBoundingBox::calculateCornerPoints( thisCorners, mCenter, mEdgeHalfLengths, mOrientation );
-    OrientedBoundingBox::calculateCornerPoints( otherCorners, otherBox.mCenter, otherBox.mEdgeHalfLengths, otherBox.mOrientation );
-
-    OrientedBoundingBox::calculateOrthogonalAxes( thisOrthogonalAxes, mOrientation );
-    OrientedBoundingBox::calculateOrthogonalAxes( otherOrthogonalAxes, otherBox.mOrientation );
-
-    // These corner points should be precalculated already
-    // Each face is determined by it's normal & a point in it, since it's basically a plane
-    Plane thisPlanes[6] = { Plane( -thisOrthogonalAxes[0], thisCorners[0] ),
-                            Plane( -thisOrthogonalAxes[1], thisCorners[0] ),
-                            Plane( -thisOrthogonalAxes[2], thisCorners[0] ),
-                            Plane(  thisOrthogonalAxes[0], thisCorners[7] ),
-                            Plane(  thisOrthogonalAxes[1], thisCorners[7] ),
-                            Plane(  thisOrthogonalAxes[2], thisCorners[7] ) };
-    Plane otherPlanes[6] = { Plane( -otherOrthogonalAxes[0], otherCorners[0] ),
-                             Plane( -otherOrthogonalAxes[1], otherCorners[0] ),
-                             Plane( -otherOrthogonalAxes[2], otherCorners[0] ),
-                             Plane(  otherOrthogonalAxes[0], otherCorners[7] ),
-                             Plane(  otherOrthogonalAxes[1], otherCorners[7] ),
-                             Plane(  otherOrthogonalAxes[2], otherCorners[7] ) };
-
     // The method of separating axes for obb collision detection works like this:
     // 1) The corners of box A are checked against each side of box B.
     // 2) The check consists on detevoid calculateOrthogonalAxes( Vector3f axes[] ) constrmining on which side (positive/negative) a corner
@@ -101,52 +99,476 @@ bool OrientedBoundingBox::collisionWith( const OrientedBoundingBox & otherBox )
     // in collision, i.e. a separating axis has been found.
     // 5) As A is checked against B, B is also checked against A.
 
+    // Boxes that were separated last frame are usually still separated by the same axis,
+    // in which case this is the only test we need
+    if( separatingAxis != -1 && isSeparatingAxis( otherBox, setup, separatingAxis ) )
+    {
+        return false;
+    }
+
     // Check corners of box 1 against faces of box 2.
     for( int i = 0; i < 6; i++ )    // 6 is number of faces to check against
     {
-        bool allPositive = true;
-        for( int j = 0; j < 8; j++ )    // 8 is number of corners to check
+        // A separating axis has been found, a collision cannot occur.
+        if( isSeparatingFace( setup.otherPlanes[i], setup.thisCorners ) )
+        {
+            separatingAxis = i;
+            return false;
+        }
+    }
+    
+    // Check corners of box 2 against faces of box 1.
+    for( int i = 0; i < 6; i++ )
+    {
+        if( isSeparatingFace( setup.thisPlanes[i], setup.otherCorners ) )
+        {
+            separatingAxis = i + 6;
+            return false;
+        }
+    }
+    
+    // No separating axis has been found, a collision MUST exist.
+    separatingAxis = -1;
+    return true;
+}
+
+bool OrientedBoundingBox::isSeparatingFace( const Plane & face, const Vector3f corners[] )
+{
+    for( int j = 0; j < 8; j++ )    // 8 is number of corners to check
+    {
+        // A negative projection has been found, no need to keep checking.
+        // It does not mean that there is a collision though.
+        if( face.isInNegativeHalfSpace( corners[j] ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The sphere check saves A LOT of time if the boxes are close but not touching, and
+// magnitudeSquared() saves a sqrt()
+bool OrientedBoundingBox::prepareSeparatingAxisTest( const OrientedBoundingBox & otherBox, SeparatingAxisSetup & setup ) const
+{
+    float minCollisionDistance = otherBox.mRadius + mRadius;
+    if( ( otherBox.mCenter - mCenter ).magnitudeSquared() > ( minCollisionDistance * minCollisionDistance ) )
+    {
+        return false;
+    }
+
+    OrientedBoundingBox::calculateCornerPoints( setup.thisCorners, mCenter, mEdgeHalfLengths, mOrientation );
+    OrientedBoundingBox::calculateCornerPoints( setup.otherCorners, otherBox.mCenter, otherBox.mEdgeHalfLengths, otherBox.mOrientation );
+
+    OrientedBoundingBox::calculateOrthogonalAxes( setup.thisAxes, mOrientation );
+    OrientedBoundingBox::calculateOrthogonalAxes( setup.otherAxes, otherBox.mOrientation );
+
+    // Each face is determined by it's normal & a point in it, since it's basically a plane
+    for( int i = 0; i < 3; i++ )
+    {
+        setup.thisPlanes[i] = Plane( -setup.thisAxes[i], setup.thisCorners[0] );
+        setup.thisPlanes[i + 3] = Plane( setup.thisAxes[i], setup.thisCorners[7] );
+        setup.otherPlanes[i] = Plane( -setup.otherAxes[i], setup.otherCorners[0] );
+        setup.otherPlanes[i + 3] = Plane( setup.otherAxes[i], setup.otherCorners[7] );
+    }
+    return true;
+}
+
+bool OrientedBoundingBox::isSeparatingAxis( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int separatingAxis ) const
+{
+    if( separatingAxis >= 0 && separatingAxis < 6 )
+    {
+        return isSeparatingFace( setup.otherPlanes[separatingAxis], setup.thisCorners );
+    }
+    if( separatingAxis >= 6 && separatingAxis < 12 )
+    {
+        return isSeparatingFace( setup.thisPlanes[separatingAxis - 6], setup.otherCorners );
+    }
+    if( separatingAxis >= 12 && separatingAxis < 21 )
+    {
+        Vector3f axis;
+        float overlap;
+        int edge = separatingAxis - 12;
+        return getEdgeAxisOverlap( otherBox, setup, edge / 3, edge % 3, axis, overlap ) && overlap < 0.0f;
+    }
+    return false;
+}
+
+bool OrientedBoundingBox::getEdgeAxisOverlap( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int thisAxis, int otherAxis, Vector3f & axis, float & overlap ) const
+{
+    axis = setup.thisAxes[thisAxis].cross( setup.otherAxes[otherAxis] );
+    float magnitudeSquared = axis.magnitudeSquared();
+    // Parallel edges give a degenerate axis that is already covered by the face normals
+    if( magnitudeSquared < 1e-6f )
+    {
+        return false;
+    }
+    axis /= sqrt( magnitudeSquared );
+
+    // Projected half widths of both boxes onto the axis
+    float thisRadius = 0.0f;
+    float otherRadius = 0.0f;
+    for( int i = 0; i < 3; i++ )
+    {
+        thisRadius += fabs( axis.dot( setup.thisAxes[i] ) ) * mEdgeHalfLengths[i];
+        otherRadius += fabs( axis.dot( setup.otherAxes[i] ) ) * otherBox.mEdgeHalfLengths[i];
+    }
+
+    float distance = axis.dot( otherBox.mCenter - mCenter );
+    if( distance < 0.0f )
+    {
+        axis = -axis;
+        distance = -distance;
+    }
+    overlap = thisRadius + otherRadius - distance;
+    return true;
+}
+
+// Same face-plane test as above. Instead of stopping at the first corner behind a face,
+// every corner's distance to every face is kept, which gives the penetration along each
+// face normal and the contact points without a second pass over the corners. The edge
+// cross products are tested after the faces.
+bool OrientedBoundingBox::collisionWith( const OrientedBoundingBox & otherBox, ContactManifold & manifold, int & separatingAxis ) const
+{
+    SeparatingAxisSetup setup;
+    if( !prepareSeparatingAxisTest( otherBox, setup ) )
+    {
+        return false;
+    }
+
+    if( separatingAxis != -1 && isSeparatingAxis( otherBox, setup, separatingAxis ) )
+    {
+        return false;
+    }
+
+    // Signed distance of each corner from each face, negative means behind the face
+    float thisCornerDistances[6][8];     // Corners of this box against faces of the other box
+    float otherCornerDistances[6][8];    // Corners of the other box against faces of this box
+
+    float thisPenetration = 0.0f;
+    float otherPenetration = 0.0f;
+    int thisReferenceFace = -1;     // Face of the other box the corners of this box are least behind
+    int otherReferenceFace = -1;    // Face of this box the corners of the other box are least behind
+
+    // Check corners of box 1 against faces of box 2.
+    for( int i = 0; i < 6; i++ )
+    {
+        float deepest = 0.0f;
+        for( int j = 0; j < 8; j++ )
         {
-            // A negative projection has been found, no need to keep checking.
-            // It does not mean that there is a collision though.
-            if( otherPlanes[i].isInNegativeHalfSpace( thisCorners[j] ) )
+            thisCornerDistances[i][j] = setup.otherPlanes[i].distanceTo( setup.thisCorners[j] );
+            if( thisCornerDistances[i][j] < deepest )
             {
-                allPositive = false;
-                break;
+                deepest = thisCornerDistances[i][j];
             }
         }
-        // A separating axis has been found, a collision cannot occur.
-        if( allPositive )
+        // No corner behind this face, it's a separating axis.
+        if( deepest >= 0.0f )
         {
+            separatingAxis = i;
             return false;
         }
+        if( thisReferenceFace == -1 || -deepest < thisPenetration )
+        {
+            thisPenetration = -deepest;
+            thisReferenceFace = i;
+        }
     }
-    
+
     // Check corners of box 2 against faces of box 1.
     for( int i = 0; i < 6; i++ )
     {
-        bool allPositive = true;
+        float deepest = 0.0f;
         for( int j = 0; j < 8; j++ )
         {
-            // A negative projection has been found, no need to keep checking.
-            // It does not mean that there is a collision though.
-            if( thisPlanes[i].isInNegativeHalfSpace( otherCorners[j] ) )
+            otherCornerDistances[i][j] = setup.thisPlanes[i].distanceTo( setup.otherCorners[j] );
+            if( otherCornerDistances[i][j] < deepest )
             {
-                allPositive = false;
-                break;
+                deepest = otherCornerDistances[i][j];
             }
         }
-        // A separating axis has been found, a collision cannot occur.
-        if( allPositive )
+        if( deepest >= 0.0f )
         {
+            separatingAxis = i + 6;
             return false;
         }
+        if( otherReferenceFace == -1 || -deepest < otherPenetration )
+        {
+            otherPenetration = -deepest;
+            otherReferenceFace = i;
+        }
     }
-    
-    // No separating axis has been found, a collision MUST exist.
+
+    // Edge on edge: the boxes can overlap along every face normal and still be apart,
+    // and when they touch, the nearest face's normal and depth can be far off
+    int edgeAxis = -1;
+    float edgePenetration = 0.0f;
+    Vector3f edgeNormal;
+    for( int i = 0; i < 9; i++ )
+    {
+        Vector3f axis;
+        float overlap;
+        if( !getEdgeAxisOverlap( otherBox, setup, i / 3, i % 3, axis, overlap ) )
+        {
+            continue;
+        }
+        if( overlap < 0.0f )
+        {
+            separatingAxis = 12 + i;
+            return false;
+        }
+        if( edgeAxis == -1 || overlap < edgePenetration )
+        {
+            edgeAxis = i;
+            edgePenetration = overlap;
+            edgeNormal = axis;
+        }
+    }
+
+    separatingAxis = -1;
+
+    // Faces give up to four contact points and are more stable from frame to frame, so
+    // an edge axis is only used when it's clearly shallower
+    if( edgeAxis != -1 && edgePenetration * 1.05f + 0.001f < std::min( thisPenetration, otherPenetration ) )
+    {
+        fillEdgeContact( otherBox, setup, edgeAxis / 3, edgeAxis % 3, edgeNormal, edgePenetration, manifold );
+        return true;
+    }
+
+    // The face with the least penetration is the reference face, and the corners of
+    // the incident box behind it are the contact points. Prefer a face of this box
+    // unless the other box's face is clearly better, so that resting contacts don't
+    // flip between the two boxes from frame to frame.
+    bool useThisFace = ( otherPenetration <= thisPenetration * 1.01f + 0.001f );
+    manifold.numPoints = 0;
+    for( int attempt = 0; attempt < 3 && manifold.numPoints == 0; attempt++ )
+    {
+        // First try the preferred face, then the other box's face. If neither face
+        // has a corner of the incident box over it, fall back to the deepest corners anyway.
+        bool thisFace = ( attempt == 1 ) ? !useThisFace : useThisFace;
+        bool requireOverFace = ( attempt < 2 );
+        if( thisFace )
+        {
+            manifold.normal = setup.thisPlanes[otherReferenceFace].getNormal();
+            manifold.penetrationDepth = otherPenetration;
+            collectContactPoints( manifold, setup.otherCorners, otherCornerDistances, otherReferenceFace, manifold.normal, requireOverFace );
+        }
+        else
+        {
+            // Face of the other box points towards this box
+            manifold.normal = -setup.otherPlanes[thisReferenceFace].getNormal();
+            manifold.penetrationDepth = thisPenetration;
+            collectContactPoints( manifold, setup.thisCorners, thisCornerDistances, thisReferenceFace, -manifold.normal, requireOverFace );
+        }
+    }
+
     return true;
 }
 
+// One contact point, halfway between the closest points of the edge of this box that
+// reaches furthest along the normal and the edge of the other box that reaches furthest
+// against it
+void OrientedBoundingBox::fillEdgeContact( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int thisAxis, int otherAxis, const Vector3f & normal, float penetration, ContactManifold & manifold ) const
+{
+    Vector3f thisEdgeCenter = mCenter;
+    Vector3f otherEdgeCenter = otherBox.mCenter;
+    for( int i = 0; i < 3; i++ )
+    {
+        if( i != thisAxis )
+        {
+            float side = normal.dot( setup.thisAxes[i] ) > 0.0f ? 1.0f : -1.0f;
+            thisEdgeCenter += setup.thisAxes[i] * ( side * mEdgeHalfLengths[i] );
+        }
+        if( i != otherAxis )
+        {
+            float side = normal.dot( setup.otherAxes[i] ) > 0.0f ? -1.0f : 1.0f;
+            otherEdgeCenter += setup.otherAxes[i] * ( side * otherBox.mEdgeHalfLengths[i] );
+        }
+    }
+
+    // Closest points of the two edges, with both directions unit length and not parallel
+    const Vector3f & thisDirection = setup.thisAxes[thisAxis];
+    const Vector3f & otherDirection = setup.otherAxes[otherAxis];
+    float thisHalfLength = mEdgeHalfLengths[thisAxis];
+    float otherHalfLength = otherBox.mEdgeHalfLengths[otherAxis];
+    Vector3f offset = thisEdgeCenter - otherEdgeCenter;
+    float directionsDot = thisDirection.dot( otherDirection );
+    float thisOffset = thisDirection.dot( offset );
+    float otherOffset = otherDirection.dot( offset );
+
+    float thisParameter = ( directionsDot * otherOffset - thisOffset ) / ( 1.0f - directionsDot * directionsDot );
+    thisParameter = std::max( -thisHalfLength, std::min( thisParameter, thisHalfLength ) );
+    float otherParameter = directionsDot * thisParameter + otherOffset;
+    otherParameter = std::max( -otherHalfLength, std::min( otherParameter, otherHalfLength ) );
+    thisParameter = directionsDot * otherParameter - thisOffset;
+    thisParameter = std::max( -thisHalfLength, std::min( thisParameter, thisHalfLength ) );
+
+    Vector3f thisPoint = thisEdgeCenter + thisDirection * thisParameter;
+    Vector3f otherPoint = otherEdgeCenter + otherDirection * otherParameter;
+    manifold.normal = normal;
+    manifold.penetrationDepth = penetration;
+    manifold.numPoints = 1;
+    manifold.points[0] = ( thisPoint + otherPoint ) * 0.5f;
+    manifold.normalImpulses[0] = 0.0f;
+}
+
+// Moving version of the separating axis test. Along every candidate axis the
+// projected intervals of the two boxes overlap during one window of time, so
+// the boxes touch during the intersection of all those windows. The start of
+// that intersection is the time of impact.
+bool OrientedBoundingBox::sweptCollisionWith( const OrientedBoundingBox & otherBox, const Vector3f & velocity, float & timeOfImpact ) const
+{
+    Vector3f centerOffset = otherBox.mCenter - mCenter;
+    float minCollisionDistance = otherBox.mRadius + mRadius;
+
+    // Sphere check against the swept segment first, just like collisionWith().
+    // Find the point on the segment from mCenter to mCenter + velocity closest
+    // to the other box's center.
+    float velocitySquared = velocity.magnitudeSquared();
+    float closestTime = 0.0f;
+    if( velocitySquared > 0.0f )
+    {
+        closestTime = centerOffset.dot( velocity ) / velocitySquared;
+        if( closestTime < 0.0f )
+        {
+            closestTime = 0.0f;
+        }
+        else if( closestTime > 1.0f )
+        {
+            closestTime = 1.0f;
+        }
+    }
+    if( ( centerOffset - velocity * closestTime ).magnitudeSquared() > ( minCollisionDistance * minCollisionDistance ) )
+    {
+        return false;
+    }
+
+    Vector3f thisOrthogonalAxes[3];
+    Vector3f otherOrthogonalAxes[3];
+    OrientedBoundingBox::calculateOrthogonalAxes( thisOrthogonalAxes, mOrientation );
+    OrientedBoundingBox::calculateOrthogonalAxes( otherOrthogonalAxes, otherBox.mOrientation );
+
+    // 15 candidate axes: 3 face normals of each box and the 9 edge cross products
+    Vector3f axes[15];
+    int numAxes = 0;
+    for( int i = 0; i < 3; i++ )
+    {
+        axes[numAxes++] = thisOrthogonalAxes[i];
+        axes[numAxes++] = otherOrthogonalAxes[i];
+    }
+    for( int i = 0; i < 3; i++ )
+    {
+        for( int j = 0; j < 3; j++ )
+        {
+            Vector3f edgeAxis = thisOrthogonalAxes[i].cross( otherOrthogonalAxes[j] );
+            // Parallel edges give a degenerate axis that is already covered by the face normals
+            if( edgeAxis.magnitudeSquared() > 1e-6f )
+            {
+                axes[numAxes++] = edgeAxis;
+            }
+        }
+    }
+
+    float firstContact = 0.0f;
+    float lastContact = 1.0f;
+    for( int i = 0; i < numAxes; i++ )
+    {
+        const Vector3f & axis = axes[i];
+
+        // Projected half widths of both boxes onto this axis
+        float thisRadius = fabs( axis.dot( thisOrthogonalAxes[0] ) ) * mEdgeHalfLengths[0] +
+                           fabs( axis.dot( thisOrthogonalAxes[1] ) ) * mEdgeHalfLengths[1] +
+                           fabs( axis.dot( thisOrthogonalAxes[2] ) ) * mEdgeHalfLengths[2];
+        float otherRadius = fabs( axis.dot( otherOrthogonalAxes[0] ) ) * otherBox.mEdgeHalfLengths[0] +
+                            fabs( axis.dot( otherOrthogonalAxes[1] ) ) * otherBox.mEdgeHalfLengths[1] +
+                            fabs( axis.dot( otherOrthogonalAxes[2] ) ) * otherBox.mEdgeHalfLengths[2];
+        float combinedRadius = thisRadius + otherRadius;
+
+        float distance = axis.dot( centerOffset );
+        float speed = axis.dot( velocity );
+
+        // Intervals overlap at time t when |distance - speed * t| <= combinedRadius
+        if( speed == 0.0f )
+        {
+            // Not moving along this axis, so it separates for the whole timestep or never
+            if( fabs( distance ) > combinedRadius )
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float enterTime = ( distance - combinedRadius ) / speed;
+        float exitTime = ( distance + combinedRadius ) / speed;
+        if( enterTime > exitTime )
+        {
+            float temp = enterTime;
+            enterTime = exitTime;
+            exitTime = temp;
+        }
+
+        if( enterTime > firstContact )
+        {
+            firstContact = enterTime;
+        }
+        if( exitTime < lastContact )
+        {
+            lastContact = exitTime;
+        }
+
+        // The overlap windows don't intersect within the timestep, a separating axis exists
+        if( firstContact > lastContact )
+        {
+            return false;
+        }
+    }
+
+    timeOfImpact = firstContact;
+    return true;
+}
+
+// Adds the deepest corners behind referenceFace to the manifold. Each contact point is put
+// halfway between the corner and the face. cornerDistances holds the distance of each corner
+// from each face of the reference box, so the side faces tell us whether a corner is over
+// the reference face rather than off to one side of it.
+void OrientedBoundingBox::collectContactPoints( ContactManifold & manifold, const Vector3f corners[], const float cornerDistances[6][8], int referenceFace, const Vector3f & faceNormal, bool requireOverFace )
+{
+    bool candidate[8];
+    for( int j = 0; j < 8; j++ )
+    {
+        candidate[j] = ( cornerDistances[referenceFace][j] < 0.0f );
+        for( int k = 0; k < 6 && requireOverFace; k++ )
+        {
+            // Faces k and k + 3 share an axis, skip the reference face and its opposite
+            if( k % 3 != referenceFace % 3 && cornerDistances[k][j] > 0.0f )
+            {
+                candidate[j] = false;
+            }
+        }
+    }
+
+    manifold.numPoints = 0;
+    while( manifold.numPoints < MAX_CONTACT_POINTS )
+    {
+        int deepestCorner = -1;
+        for( int j = 0; j < 8; j++ )
+        {
+            if( candidate[j] && ( deepestCorner == -1 || cornerDistances[referenceFace][j] < cornerDistances[referenceFace][deepestCorner] ) )
+            {
+                deepestCorner = j;
+            }
+        }
+        if( deepestCorner == -1 )
+        {
+            break;
+        }
+
+        candidate[deepestCorner] = false;
+        manifold.points[manifold.numPoints] = corners[deepestCorner] - faceNormal * ( cornerDistances[referenceFace][deepestCorner] * 0.5f );
+        manifold.normalImpulses[manifold.numPoints] = 0.0f;
+        manifold.numPoints++;
+    }
+}
+
 void OrientedBoundingBox::draw( const Vector3f & color ) const
 {
     Vector3f corners[8];
@@ -237,8 +659,10 @@ void OrientedBoundingBox::calculateCornerPoints( Vector3f corners[], const Vecto
 
 void OrientedBoundingBox::calculateOrthogonalAxes( Vector3f axes[], const Quaternion & orientation )
 {
-	axes[0] = orientation * Vector3f( 1.0f, 0.0f, 0.0f );
-	axes[1] = orientation * Vector3f( 0.0f, 1.0f, 0.0f );
-	axes[2] = orientation * Vector3f( 0.0f, 0.0f, 1.0f );
+	// The columns of the rotation matrix are the rotated x, y, and z axes
+	Matrix3f rotation( orientation );
+	axes[0] = rotation.getColumn( 0 );
+	axes[1] = rotation.getColumn( 1 );
+	axes[2] = rotation.getColumn( 2 );
 }
 
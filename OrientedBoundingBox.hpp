@@ -4,6 +4,14 @@
 #include "Math.hpp"
 #include <iostream>
 
+#define MAX_CONTACT_POINTS 4
+
+// A box has to stay within these of where it came to rest to count as resting
+#define SLEEP_LINEAR_THRESHOLD 0.01f
+#define SLEEP_ANGULAR_THRESHOLD 0.00001f    // In terms of 1 - |q1 . q2|
+// Number of frames a box has to rest before it can be put to sleep
+#define SLEEP_FRAMES 60
+
 // Notes on orientation of corners and axes.
 // Axes are such that x is out, y is right, and z is up.
 // These correspond to mOrthogonalAxes indices 0, 1, and 2.
@@ -33,6 +41,20 @@
 //      | |____________________| | /
 //  (1) |________________________|/ (2)
 
+// Contact data filled in by the narrowphase, for resolving penetration. The normal is
+// a face normal of one of the boxes, with up to four points from the corners of the
+// other box, or for boxes meeting edge to edge the cross product of their edges, with a
+// single point between the edges.
+struct ContactManifold
+{
+    Vector3f normal;              // Axis of minimum penetration, pointing from the first box towards the second
+    float    penetrationDepth;    // How far the boxes overlap along normal
+    int      numPoints;
+    Vector3f points[MAX_CONTACT_POINTS];
+    // Accumulated by the physics solver, kept across frames by PairCache for warm starting
+    float    normalImpulses[MAX_CONTACT_POINTS];
+};
+
 class OrientedBoundingBox
 {
     public:
@@ -44,6 +66,10 @@ class OrientedBoundingBox
 
         Vector3f getCenter() const { return mCenter; };
         void setCenter( const Vector3f & newCenter ) { mCenter = newCenter; };
+        Vector3f getEdgeHalfLengths() const { return mEdgeHalfLengths; };
+        Quaternion getOrientation() const { return mOrientation; };
+        // For placing the box directly, e.g. at an orientation interpolated between two physics steps
+        void setOrientation( const Quaternion & newOrientation ) { mOrientation = newOrientation; };
 
 		// Max distance to a corner to center
         float getRadius() const { return mRadius; };
@@ -51,10 +77,37 @@ class OrientedBoundingBox
 		bool getCollisionState() const { return mHasCollided; };
 		void setCollisionState( bool newState ) { mHasCollided = newState; };
 
+		// Sleeping boxes are skipped by the broadphase, see IslandManager
+		bool isAsleep() const { return mIsAsleep; };
+		void sleep() { mIsAsleep = true; };
+		void wakeUp() { mIsAsleep = false; mFramesAtRest = 0; };
+		int getFramesAtRest() const { return mFramesAtRest; };
+		// Call once per frame. Returns true if the box has moved past the sleep thresholds since
+		// it came to rest, otherwise counts another frame at rest.
+		bool updateRestState();
+
         void rotate( const Vector3f & axis, float degrees );
 
         bool isPointInside( const Vector3f & point ) const;
-        bool collisionWith( const OrientedBoundingBox & otherBox ) const;
+        bool collisionWith( const OrientedBoundingBox & otherBox ) const { int separatingAxis = -1; return collisionWith( otherBox, separatingAxis ); };
+        // Same test as above, for pairs that are checked frame after frame. separatingAxis is tried
+        // first if it's not -1, and is set to the separating axis found, or -1 on a collision.
+        // 0-5 are faces of otherBox and 6-11 are faces of this box, so the index stays meaningful
+        // as the boxes move and rotate. Only faces are tested, but 12-20 from the manifold version
+        // below are accepted as a cached axis.
+        bool collisionWith( const OrientedBoundingBox & otherBox, int & separatingAxis ) const;
+        // Same test as above plus the 9 edge cross products, so it's exact, and fills in the
+        // manifold when a collision exists.
+        // The manifold's impulses are zeroed, see PairCache for keeping them across frames.
+        bool collisionWith( const OrientedBoundingBox & otherBox, ContactManifold & manifold ) const { int separatingAxis = -1; return collisionWith( otherBox, manifold, separatingAxis ); };
+        // Manifold version of the cached test. separatingAxis works the same way, with 12-20 for the
+        // edge cross products, numbered this box's axis * 3 + otherBox's axis.
+        bool collisionWith( const OrientedBoundingBox & otherBox, ContactManifold & manifold, int & separatingAxis ) const;
+        // Sweeps this box along velocity (its displacement over the whole timestep)
+        // against otherBox, which is treated as stationary. For two moving boxes pass
+        // the relative velocity. On a hit, timeOfImpact is the earliest fraction of
+        // the timestep, in [0, 1], at which the boxes touch.
+        bool sweptCollisionWith( const OrientedBoundingBox & otherBox, const Vector3f & velocity, float & timeOfImpact ) const;
 
         void move( const Vector3f & velocity ) { mCenter += velocity; };
         void draw( const Vector3f & color ) const;
@@ -65,6 +118,31 @@ class OrientedBoundingBox
         static void calculateOrthogonalAxes( Vector3f axes[], const Quaternion & orientation );
 
     private:
+        // Corners, axes and faces of both boxes, shared by the collisionWith() overloads
+        struct SeparatingAxisSetup
+        {
+            Vector3f thisCorners[8];
+            Vector3f otherCorners[8];
+            Vector3f thisAxes[3];
+            Vector3f otherAxes[3];
+            Plane    thisPlanes[6];     // -x, -y, -z, +x, +y, +z
+            Plane    otherPlanes[6];
+        };
+
+        // False if the bounding spheres don't touch, in which case setup isn't filled in
+        bool prepareSeparatingAxisTest( const OrientedBoundingBox & otherBox, SeparatingAxisSetup & setup ) const;
+        // Tests a single axis numbered as in collisionWith()
+        bool isSeparatingAxis( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int separatingAxis ) const;
+        // Overlap of the boxes' projections onto the cross product of this box's axis
+        // thisAxis and the other box's axis otherAxis, negative if it separates them. axis
+        // is normalized and points towards the other box. False if the edges are parallel.
+        bool getEdgeAxisOverlap( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int thisAxis, int otherAxis, Vector3f & axis, float & overlap ) const;
+        // Fills in the manifold for an edge on edge contact, helper for collisionWith()
+        void fillEdgeContact( const OrientedBoundingBox & otherBox, const SeparatingAxisSetup & setup, int thisAxis, int otherAxis, const Vector3f & normal, float penetration, ContactManifold & manifold ) const;
+        // True if all of the corners are in front of the face, so it's a separating plane
+        static bool isSeparatingFace( const Plane & face, const Vector3f corners[] );
+        // Fills in the manifold's contact points from corners of the incident box, helper for collisionWith()
+        static void collectContactPoints( ContactManifold & manifold, const Vector3f corners[], const float cornerDistances[6][8], int referenceFace, const Vector3f & faceNormal, bool requireOverFace );
         void calculateRadius() { mRadius = mEdgeHalfLengths.magnitude(); };
 
         Vector3f   mCenter;
@@ -73,6 +151,11 @@ class OrientedBoundingBox
         
         bool mHasCollided;
 
+        bool       mIsAsleep;
+        int        mFramesAtRest;
+        Vector3f   mRestCenter;         // Where the box was when it came to rest
+        Quaternion mRestOrientation;
+
         float mRadius;    // Maximum distance to a corner
 };
 
@@ -0,0 +1,410 @@
+#include "PagedTerrain.hpp"
+#include "ImageLoader.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+
+// Buffer objects are core since OpenGL 1.5, but only declared by glext.h
+#define GL_GLEXT_PROTOTYPES
+#include "GL/glut.h"
+
+/***************************************
+* Class Methods
+***************************************/
+PagedTerrain::PagedTerrain( const std::string & tileFilename, const std::string & textureFilename ) :
+	mTileFilename( tileFilename ),
+	mTilesAlongX( 0 ),
+	mTilesAlongZ( 0 ),
+	mLoadingKey( -1 ),
+	mIsStopping( false )
+{
+	mTexture = new Texture( textureFilename );
+
+	memset( &mHeader, 0, sizeof( mHeader ) );
+	FILE * file = fopen( tileFilename.c_str(), "rb" );
+	if( file == NULL || fread( &mHeader, sizeof( mHeader ), 1, file ) != 1 || strncmp( mHeader.magicNumber, "SPTL", 4 ) != 0 )
+	{
+		std::cerr << "Not a terrain tile file: " << tileFilename << std::endl;
+		memset( &mHeader, 0, sizeof( mHeader ) );
+	}
+	else
+	{
+		mTilesAlongX = ( mHeader.width - 2 ) / mHeader.tileSize + 1;
+		mTilesAlongZ = ( mHeader.length - 2 ) / mHeader.tileSize + 1;
+	}
+	if( file != NULL )
+	{
+		fclose( file );
+	}
+
+	mWorker = std::thread( &PagedTerrain::workerLoop, this );
+}
+
+PagedTerrain::~PagedTerrain()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mIsStopping = true;
+	}
+	mRequestsChanged.notify_one();
+	mWorker.join();
+
+	for( unsigned int i = 0; i < mLoaded.size(); i++ )
+	{
+		delete mLoaded[i];
+	}
+	while( !mTiles.empty() )
+	{
+		evictTile();
+	}
+	delete mTexture;
+}
+
+bool PagedTerrain::convertHeightmap( const std::string & heightmapFilename, const std::string & tileFilename, float heightScale, int tileSize )
+{
+	uint16_t *samples = NULL;
+	int width = 0;
+	int length = 0;
+	// Rows of the file run along x, the same as Terrain
+	loadHeightmap( heightmapFilename, samples, length, width );
+	if( samples == NULL || width < 2 || length < 2 )
+	{
+		delete [] samples;
+		return false;
+	}
+
+	FILE * file = fopen( tileFilename.c_str(), "wb" );
+	if( file == NULL )
+	{
+		delete [] samples;
+		return false;
+	}
+
+	PagedTerrainHeader header;
+	memcpy( header.magicNumber, "SPTL", 4 );
+	header.width = width;
+	header.length = length;
+	header.tileSize = tileSize;
+	bool isWritten = fwrite( &header, sizeof( header ), 1, file ) == 1;
+
+	int rowLength = tileSize + 1 + 2 * PAGED_TERRAIN_APRON;
+	std::vector<float> heights( rowLength * rowLength );
+	for( int tileX = 0; tileX * tileSize < width - 1; tileX++ )
+	{
+		for( int tileZ = 0; tileZ * tileSize < length - 1; tileZ++ )
+		{
+			for( int i = 0; i < rowLength; i++ )
+			{
+				for( int j = 0; j < rowLength; j++ )
+				{
+					int x = std::max( 0, std::min( tileX * tileSize + i - PAGED_TERRAIN_APRON, width - 1 ) );
+					int z = std::max( 0, std::min( tileZ * tileSize + j - PAGED_TERRAIN_APRON, length - 1 ) );
+					// Same scale and offset as Terrain
+					heights[i * rowLength + j] = -0.5f * heightScale + samples[x * length + z] * ( heightScale / 65535.0f );
+				}
+			}
+			isWritten = isWritten && fwrite( &heights[0], sizeof( float ), heights.size(), file ) == heights.size();
+		}
+	}
+
+	fclose( file );
+	delete [] samples;
+	return isWritten;
+}
+
+void PagedTerrain::update( const Vector3f & position )
+{
+	if( mTilesAlongX == 0 )
+	{
+		return;
+	}
+
+	// Tiles around the camera, nearest first
+	int cameraTileX = static_cast<int>( floor( position[0] / mHeader.tileSize ) );
+	int cameraTileZ = static_cast<int>( floor( position[2] / mHeader.tileSize ) );
+	std::vector<std::pair<int, int> > wanted;
+	for( int tileX = cameraTileX - PAGED_TERRAIN_LOAD_RADIUS; tileX <= cameraTileX + PAGED_TERRAIN_LOAD_RADIUS; tileX++ )
+	{
+		for( int tileZ = cameraTileZ - PAGED_TERRAIN_LOAD_RADIUS; tileZ <= cameraTileZ + PAGED_TERRAIN_LOAD_RADIUS; tileZ++ )
+		{
+			if( tileX >= 0 && tileX < mTilesAlongX && tileZ >= 0 && tileZ < mTilesAlongZ )
+			{
+				int distance = std::max( abs( tileX - cameraTileX ), abs( tileZ - cameraTileZ ) );
+				wanted.push_back( std::make_pair( distance, getTileKey( tileX, tileZ ) ) );
+			}
+		}
+	}
+	std::sort( wanted.begin(), wanted.end() );
+
+	// Touch the wanted tiles that are resident, iterating farthest first so the
+	// nearest end up at the front of the list
+	for( int i = wanted.size() - 1; i >= 0; i-- )
+	{
+		std::map<int, std::list<ResidentTile>::iterator>::iterator found = mTileLookup.find( wanted[i].second );
+		if( found != mTileLookup.end() )
+		{
+			mTiles.splice( mTiles.begin(), mTiles, found->second );
+		}
+	}
+
+	std::vector<LoadedTile *> finished;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+
+		// Replace the old requests, so tiles the camera has moved away from are dropped
+		mRequests.clear();
+		for( unsigned int i = 0; i < wanted.size(); i++ )
+		{
+			int key = wanted[i].second;
+			bool isLoaded = false;
+			for( unsigned int j = 0; j < mLoaded.size() && !isLoaded; j++ )
+			{
+				isLoaded = mLoaded[j]->key == key;
+			}
+			if( !isLoaded && key != mLoadingKey && mTileLookup.count( key ) == 0 )
+			{
+				mRequests.push_back( key );
+			}
+		}
+
+		// Take only as many finished tiles as will be uploaded this frame, the rest wait
+		int uploadCount = std::min( static_cast<int>( mLoaded.size() ), PAGED_TERRAIN_UPLOADS_PER_FRAME );
+		finished.assign( mLoaded.begin(), mLoaded.begin() + uploadCount );
+		mLoaded.erase( mLoaded.begin(), mLoaded.begin() + uploadCount );
+	}
+	mRequestsChanged.notify_one();
+
+	for( unsigned int i = 0; i < finished.size(); i++ )
+	{
+		uploadTile( finished[i] );
+	}
+	while( mTiles.size() > PAGED_TERRAIN_MAX_TILES )
+	{
+		evictTile();
+	}
+}
+
+void PagedTerrain::render( const Frustum & frustum ) const
+{
+	mTexture->bind();
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_NORMAL_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+
+	for( std::list<ResidentTile>::const_iterator tile = mTiles.begin(); tile != mTiles.end(); ++tile )
+	{
+		if( !frustum.isAxisAlignedBoxInFrustum( tile->minCorner, tile->maxCorner ) )
+		{
+			continue;
+		}
+
+		glBindBuffer( GL_ARRAY_BUFFER, tile->vertexBuffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, tile->indexBuffer );
+		glVertexPointer( 3, GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, position ) ) );
+		glNormalPointer( GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, normal ) ) );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, texCoord ) ) );
+		glDrawElements( GL_TRIANGLE_STRIP, tile->indexCount, GL_UNSIGNED_INT, 0 );
+	}
+
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void PagedTerrain::workerLoop()
+{
+	FILE * file = fopen( mTileFilename.c_str(), "rb" );
+
+	std::unique_lock<std::mutex> lock( mMutex );
+	while( true )
+	{
+		while( !mIsStopping && mRequests.empty() )
+		{
+			mRequestsChanged.wait( lock );
+		}
+		if( mIsStopping )
+		{
+			break;
+		}
+
+		int key = mRequests.front();
+		mRequests.pop_front();
+		mLoadingKey = key;
+
+		// Reading and building a tile is the slow part, so do it without holding the lock
+		lock.unlock();
+		LoadedTile * loaded = file != NULL ? loadTile( file, key ) : NULL;
+		lock.lock();
+
+		if( loaded != NULL )
+		{
+			mLoaded.push_back( loaded );
+		}
+		mLoadingKey = -1;
+	}
+
+	if( file != NULL )
+	{
+		fclose( file );
+	}
+}
+
+// Normals are computed the same way as Terrain::computeNormals(), from the tile's apron
+// instead of its neighbors, so the tiles' edges match up
+PagedTerrain::LoadedTile * PagedTerrain::loadTile( FILE * file, int key ) const
+{
+	int tileSize = mHeader.tileSize;
+	int rowLength = tileSize + 1 + 2 * PAGED_TERRAIN_APRON;
+	std::vector<float> heights( rowLength * rowLength );
+	long offset = sizeof( PagedTerrainHeader ) + static_cast<long>( key ) * heights.size() * sizeof( float );
+	if( fseek( file, offset, SEEK_SET ) != 0 || fread( &heights[0], sizeof( float ), heights.size(), file ) != heights.size() )
+	{
+		return NULL;
+	}
+
+	int startX = ( key / mTilesAlongZ ) * tileSize;
+	int startZ = ( key % mTilesAlongZ ) * tileSize;
+	int endX = std::min( startX + tileSize, mHeader.width - 1 );
+	int endZ = std::min( startZ + tileSize, mHeader.length - 1 );
+	int originX = startX - PAGED_TERRAIN_APRON;
+	int originZ = startZ - PAGED_TERRAIN_APRON;
+
+	// Face normals summed around each sample, for the tile and one sample around it.
+	// Samples past the edges of the map don't count, as in Terrain.
+	std::vector<Vector3f> faceNormals( rowLength * rowLength );
+	for( int x = std::max( startX - 1, 0 ); x <= std::min( endX + 1, mHeader.width - 1 ); x++ )
+	{
+		for( int z = std::max( startZ - 1, 0 ); z <= std::min( endZ + 1, mHeader.length - 1 ); z++ )
+		{
+			int i = x - originX;
+			int j = z - originZ;
+			float height = heights[i * rowLength + j];
+			Vector3f left( -1.0f, heights[( i - 1 ) * rowLength + j] - height, 0.0f );
+			Vector3f right( 1.0f, heights[( i + 1 ) * rowLength + j] - height, 0.0f );
+			Vector3f out( 0.0f, heights[i * rowLength + j - 1] - height, -1.0f );
+			Vector3f in( 0.0f, heights[i * rowLength + j + 1] - height, 1.0f );
+
+			Vector3f sum( 0.0f, 0.0f, 0.0f );
+			if( x > 0 && z > 0 )
+			{
+				sum += out.cross( left ).normalize();
+			}
+			if( x > 0 && z < mHeader.length - 1 )
+			{
+				sum += left.cross( in ).normalize();
+			}
+			if( x < mHeader.width - 1 && z < mHeader.length - 1 )
+			{
+				sum += in.cross( right ).normalize();
+			}
+			if( x < mHeader.width - 1 && z > 0 )
+			{
+				sum += right.cross( out ).normalize();
+			}
+			faceNormals[i * rowLength + j] = sum;
+		}
+	}
+
+	LoadedTile * loaded = new LoadedTile();
+	loaded->key = key;
+
+	int tileRowLength = endZ - startZ + 1;
+	float textureCoordDelta = 0.1f;
+	float dropOffRatio = 0.5f;
+	float minHeight = heights[PAGED_TERRAIN_APRON * rowLength + PAGED_TERRAIN_APRON];
+	float maxHeight = minHeight;
+	loaded->vertices.resize( ( endX - startX + 1 ) * tileRowLength );
+	for( int x = startX; x <= endX; x++ )
+	{
+		for( int z = startZ; z <= endZ; z++ )
+		{
+			int i = x - originX;
+			int j = z - originZ;
+			float height = heights[i * rowLength + j];
+			minHeight = std::min( minHeight, height );
+			maxHeight = std::max( maxHeight, height );
+
+			Vector3f normal = faceNormals[i * rowLength + j];
+			if( x > 0 )
+			{
+				normal += faceNormals[( i - 1 ) * rowLength + j] * dropOffRatio;
+			}
+			if( x < mHeader.width - 1 )
+			{
+				normal += faceNormals[( i + 1 ) * rowLength + j] * dropOffRatio;
+			}
+			if( z > 0 )
+			{
+				normal += faceNormals[i * rowLength + j - 1] * dropOffRatio;
+			}
+			if( z < mHeader.length - 1 )
+			{
+				normal += faceNormals[i * rowLength + j + 1] * dropOffRatio;
+			}
+			normal = normal.normalize();
+
+			TerrainVertex vertex = { { static_cast<float>( x ), height, static_cast<float>( z ) },
+			                         { normal[0], normal[1], normal[2] },
+			                         { x * textureCoordDelta, z * textureCoordDelta } };
+			loaded->vertices[( x - startX ) * tileRowLength + ( z - startZ )] = vertex;
+		}
+	}
+
+	// One strip per row of quads, joined by degenerate triangles as in Terrain
+	for( int z = 0; z < endZ - startZ; z++ )
+	{
+		if( z > 0 )
+		{
+			loaded->indices.push_back( loaded->indices.back() );
+			loaded->indices.push_back( z );
+		}
+		for( int x = 0; x <= endX - startX; x++ )
+		{
+			loaded->indices.push_back( x * tileRowLength + z );
+			loaded->indices.push_back( x * tileRowLength + z + 1 );
+		}
+	}
+
+	loaded->minCorner = Vector3f( startX, minHeight, startZ );
+	loaded->maxCorner = Vector3f( endX, maxHeight, endZ );
+	return loaded;
+}
+
+void PagedTerrain::uploadTile( LoadedTile * loaded )
+{
+	ResidentTile tile;
+	tile.key = loaded->key;
+	tile.minCorner = loaded->minCorner;
+	tile.maxCorner = loaded->maxCorner;
+	tile.indexCount = loaded->indices.size();
+
+	glGenBuffers( 1, &tile.vertexBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, tile.vertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, loaded->vertices.size() * sizeof( TerrainVertex ), &loaded->vertices[0], GL_STATIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	glGenBuffers( 1, &tile.indexBuffer );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, tile.indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, loaded->indices.size() * sizeof( unsigned int ), &loaded->indices[0], GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	mTiles.push_front( tile );
+	mTileLookup[tile.key] = mTiles.begin();
+	delete loaded;
+}
+
+void PagedTerrain::evictTile()
+{
+	ResidentTile & tile = mTiles.back();
+	glDeleteBuffers( 1, &tile.vertexBuffer );
+	glDeleteBuffers( 1, &tile.indexBuffer );
+	mTileLookup.erase( tile.key );
+	mTiles.pop_back();
+}
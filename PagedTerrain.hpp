@@ -0,0 +1,112 @@
+#ifndef PAGED_TERRAIN_HPP
+#define PAGED_TERRAIN_HPP
+
+#include "Math.hpp"
+#include "Terrain.hpp"
+#include "Texture.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+// Quads along each edge of a tile, the unit of loading, culling and eviction
+#define PAGED_TERRAIN_TILE_SIZE 64
+// Samples stored around each tile on disk, enough to compute the normals on its edges
+#define PAGED_TERRAIN_APRON 2
+// Tiles within this many tiles of the camera are loaded, in each direction
+#define PAGED_TERRAIN_LOAD_RADIUS 3
+// Resident tile cap, must be at least ( 2 * PAGED_TERRAIN_LOAD_RADIUS + 1 )^2
+#define PAGED_TERRAIN_MAX_TILES 64
+// Loaded tiles uploaded to GL per update(), so arriving tiles never stall a frame
+#define PAGED_TERRAIN_UPLOADS_PER_FRAME 2
+
+// Tiled heightmap file: this header, then each tile's heights as floats, ordered by
+// tile x then tile z. A tile of size quads stores ( size + 1 + 2 * apron )^2 samples,
+// clamped to the edges of the map, so tiles can be read and built independently.
+struct PagedTerrainHeader
+{
+	char		magicNumber[4];		// "SPTL"
+	int32_t		width;				// Samples along x
+	int32_t		length;				// Samples along z
+	int32_t		tileSize;			// Quads along each edge of a tile
+};
+
+// Terrain for heightmaps too large to keep in memory. Tiles around the camera are read
+// from a file written by convertHeightmap() on a worker thread, which also computes their
+// normals and vertices. The render thread only uploads finished tiles and evicts the
+// least recently used ones once there are more than PAGED_TERRAIN_MAX_TILES.
+class PagedTerrain
+{
+	public:
+		PagedTerrain( const std::string & tileFilename, const std::string & textureFilename );
+		~PagedTerrain();
+
+		// Writes any heightmap loadHeightmap() reads as a tile file, heights ranging from
+		// -heightScale / 2 to heightScale / 2
+		static bool convertHeightmap( const std::string & heightmapFilename, const std::string & tileFilename, float heightScale, int tileSize = PAGED_TERRAIN_TILE_SIZE );
+
+		// Queues the tiles around position nearest first, uploads finished tiles and
+		// evicts old ones. Call once a frame, from the thread owning the GL context.
+		void update( const Vector3f & position );
+		// Draws the resident tiles whose bounding boxes are inside the frustum
+		void render( const Frustum & frustum ) const;
+
+		int getWidth() const { return mHeader.width; };
+		int getLength() const { return mHeader.length; };
+		int getResidentTileCount() const { return mTiles.size(); };
+		bool isTileResident( int tileX, int tileZ ) const { return mTileLookup.count( getTileKey( tileX, tileZ ) ) > 0; };
+
+	private:
+		// Built by the worker thread, waiting to be uploaded
+		struct LoadedTile
+		{
+			int								key;
+			Vector3f						minCorner;
+			Vector3f						maxCorner;
+			std::vector<TerrainVertex>		vertices;
+			std::vector<unsigned int>		indices;
+		};
+
+		struct ResidentTile
+		{
+			int				key;
+			Vector3f		minCorner;
+			Vector3f		maxCorner;
+			unsigned int	vertexBuffer;
+			unsigned int	indexBuffer;
+			int				indexCount;
+		};
+
+		int getTileKey( int tileX, int tileZ ) const { return tileX * mTilesAlongZ + tileZ; };
+		void workerLoop();
+		// Reads one tile and builds its vertices; runs on the worker thread
+		LoadedTile * loadTile( FILE * file, int key ) const;
+		void uploadTile( LoadedTile * loaded );
+		void evictTile();
+
+		PagedTerrainHeader	mHeader;
+		std::string			mTileFilename;
+		int					mTilesAlongX;
+		int					mTilesAlongZ;
+		Texture				*mTexture;
+
+		// Most recently used first; the lookup holds each tile's position in the list
+		std::list<ResidentTile>								mTiles;
+		std::map<int, std::list<ResidentTile>::iterator>	mTileLookup;
+
+		// Shared with the worker thread, guarded by mMutex
+		std::mutex					mMutex;
+		std::condition_variable		mRequestsChanged;
+		std::deque<int>				mRequests;			// Nearest first
+		std::vector<LoadedTile *>	mLoaded;
+		int							mLoadingKey;		// Tile the worker is reading, -1 if none
+		bool						mIsStopping;
+		std::thread					mWorker;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "PairCache.hpp"
+#include <algorithm>
+
+bool PairCache::collisionWith( const OrientedBoundingBox * box1, const OrientedBoundingBox * box2 )
+{
+    PairEntry & entry = mEntries[PairKey( box1, box2 )];
+    return box1->collisionWith( *box2, entry.separatingAxis );
+}
+
+ContactManifold * PairCache::collide( const OrientedBoundingBox * box1, const OrientedBoundingBox * box2 )
+{
+    // Creates an empty entry the first time a pair is seen
+    PairEntry & entry = mEntries[PairKey( box1, box2 )];
+
+    // Pairs that were apart last frame are rejected by their old separating axis alone,
+    // and pairs that come apart remember what separates them for next frame
+    ContactManifold newManifold;
+    if( !box1->collisionWith( *box2, newManifold, entry.separatingAxis ) )
+    {
+        entry.manifold.numPoints = 0;
+        return NULL;
+    }
+
+    // Match each new contact point with the closest old one, and start its
+    // impulse where the old one left off
+    const ContactManifold & oldManifold = entry.manifold;
+    for( int i = 0; i < newManifold.numPoints; i++ )
+    {
+        float closestDistance = CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE;
+        for( int j = 0; j < oldManifold.numPoints; j++ )
+        {
+            float distance = ( newManifold.points[i] - oldManifold.points[j] ).magnitudeSquared();
+            if( distance <= closestDistance )
+            {
+                closestDistance = distance;
+                newManifold.normalImpulses[i] = oldManifold.normalImpulses[j];
+            }
+        }
+    }
+
+    entry.manifold = newManifold;
+    return &entry.manifold;
+}
+
+void PairCache::retainPairs( const std::vector<BoxPair> & pairs )
+{
+    std::vector<PairKey> currentPairs;
+    currentPairs.reserve( pairs.size() );
+    for( std::vector<BoxPair>::const_iterator it = pairs.begin(); it != pairs.end(); ++it )
+    {
+        currentPairs.push_back( PairKey( it->box1, it->box2 ) );
+    }
+    std::sort( currentPairs.begin(), currentPairs.end() );
+
+    std::map<PairKey, PairEntry>::iterator it = mEntries.begin();
+    while( it != mEntries.end() )
+    {
+        if( std::binary_search( currentPairs.begin(), currentPairs.end(), it->first ) )
+        {
+            ++it;
+        }
+        else
+        {
+            mEntries.erase( it++ );
+        }
+    }
+}
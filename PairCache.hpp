@@ -0,0 +1,50 @@
+#ifndef PAIR_CACHE_HPP
+#define PAIR_CACHE_HPP
+
+#include "Math.hpp"
+#include "OrientedBoundingBox.hpp"
+#include "Octree.hpp"
+#include <map>
+#include <utility>
+#include <vector>
+
+// How close a contact point has to stay to last frame's point to keep its impulse
+#define CONTACT_MATCH_DISTANCE 0.05f
+
+// Narrowphase data that is kept for each pair of boxes from one frame to the next.
+// Pairs are keyed on the order they're passed in, so always pass a pair in the same
+// order; the pairs from Octree::getPotentialCollisionPairs() already are.
+class PairCache
+{
+    public:
+        // Boolean narrowphase for the pair. The separating axis found last frame is tried
+        // first, so pairs that stay apart usually only need a single face test.
+        bool collisionWith( const OrientedBoundingBox * box1, const OrientedBoundingBox * box2 );
+        // Runs the narrowphase on the pair, trying last frame's separating axis first the same
+        // way as collisionWith(). Returns NULL if they don't collide, otherwise
+        // the cached manifold, with impulses carried over from last frame for contact
+        // points that barely moved. The solver should write its accumulated impulses
+        // back into the returned manifold so they can warm start the next frame.
+        ContactManifold * collide( const OrientedBoundingBox * box1, const OrientedBoundingBox * box2 );
+
+        // Evicts every pair that isn't in this frame's broadphase output. Call once per frame
+        // with the pairs from Octree::getPotentialCollisionPairs().
+        void retainPairs( const std::vector<BoxPair> & pairs );
+        void clear() { mEntries.clear(); };
+        int size() const { return mEntries.size(); };
+
+    private:
+        typedef std::pair<const OrientedBoundingBox *, const OrientedBoundingBox *> PairKey;
+
+        struct PairEntry
+        {
+            PairEntry() : separatingAxis( -1 ) { manifold.numPoints = 0; };
+
+            int separatingAxis;          // From OrientedBoundingBox::collisionWith(), -1 if none
+            ContactManifold manifold;    // numPoints is 0 when the pair wasn't colliding last frame
+        };
+
+        std::map<PairKey, PairEntry> mEntries;
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "Quantize.hpp"
+#include <emmintrin.h>
+
+#define SNORM16_SCALE 32767.0f
+#define UNORM16_MAX 65535.0f
+
+// Rounds to nearest like _mm_cvtps_epi32(), so the scalar and batch versions agree
+static int16_t toSnorm16( float value )
+{
+	value = value < -1.0f ? -1.0f : ( value > 1.0f ? 1.0f : value );
+	return static_cast<int16_t>( lrintf( value * SNORM16_SCALE ) );
+}
+
+static float fromSnorm16( int16_t value )
+{
+	return value * ( 1.0f / SNORM16_SCALE );
+}
+
+// Sign extends the low and high 16 bits of each 32-bit lane
+static inline __m128i lowHalves( __m128i value ) { return _mm_srai_epi32( _mm_slli_epi32( value, 16 ), 16 ); }
+static inline __m128i highHalves( __m128i value ) { return _mm_srai_epi32( value, 16 ); }
+
+/***********************************************************
+ * PackedNormal Class Methods
+ **********************************************************/
+PackedNormal::PackedNormal( const Vector3f & normal )
+{
+	float inverseLength = 1.0f / ( fabsf( normal[0] ) + fabsf( normal[1] ) + fabsf( normal[2] ) );
+	float x = normal[0] * inverseLength;
+	float y = normal[1] * inverseLength;
+
+	// Fold the lower half of the octahedron over the upper half
+	if( normal[2] < 0.0f )
+	{
+		float foldedX = ( 1.0f - fabsf( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+		float foldedY = ( 1.0f - fabsf( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+		x = foldedX;
+		y = foldedY;
+	}
+
+	mX = toSnorm16( x );
+	mY = toSnorm16( y );
+}
+
+Vector3f PackedNormal::unpack() const
+{
+	float x = fromSnorm16( mX );
+	float y = fromSnorm16( mY );
+	float z = 1.0f - fabsf( x ) - fabsf( y );
+
+	// Unfold points that were on the lower half
+	float fold = z < 0.0f ? -z : 0.0f;
+	x += x >= 0.0f ? -fold : fold;
+	y += y >= 0.0f ? -fold : fold;
+
+	return Vector3f( x, y, z ).normalize();
+}
+
+void PackedNormal::pack( const Vector3fArray & normals, PackedNormal * out )
+{
+	const float * nx = normals.x();
+	const float * ny = normals.y();
+	const float * nz = normals.z();
+	int count = normals.size();
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	const __m128 scale = _mm_set1_ps( SNORM16_SCALE );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 x = _mm_loadu_ps( nx + i );
+		__m128 y = _mm_loadu_ps( ny + i );
+		__m128 z = _mm_loadu_ps( nz + i );
+
+		__m128 absoluteSum = _mm_add_ps( _mm_add_ps( _mm_andnot_ps( signMask, x ), _mm_andnot_ps( signMask, y ) ), _mm_andnot_ps( signMask, z ) );
+		__m128 inverseLength = _mm_div_ps( one, absoluteSum );
+		x = _mm_mul_ps( x, inverseLength );
+		y = _mm_mul_ps( y, inverseLength );
+
+		__m128 foldedX = _mm_mul_ps( _mm_sub_ps( one, _mm_andnot_ps( signMask, y ) ), _mm_or_ps( one, _mm_and_ps( signMask, x ) ) );
+		__m128 foldedY = _mm_mul_ps( _mm_sub_ps( one, _mm_andnot_ps( signMask, x ) ), _mm_or_ps( one, _mm_and_ps( signMask, y ) ) );
+		__m128 isLowerHalf = _mm_cmplt_ps( z, zero );
+		x = _mm_or_ps( _mm_and_ps( isLowerHalf, foldedX ), _mm_andnot_ps( isLowerHalf, x ) );
+		y = _mm_or_ps( _mm_and_ps( isLowerHalf, foldedY ), _mm_andnot_ps( isLowerHalf, y ) );
+
+		// x0 x1 x2 x3 y0 y1 y2 y3, saturated to 16 bits, then interleaved to x0 y0 x1 y1 ...
+		__m128i packed = _mm_packs_epi32( _mm_cvtps_epi32( _mm_mul_ps( x, scale ) ), _mm_cvtps_epi32( _mm_mul_ps( y, scale ) ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( out + i ), _mm_unpacklo_epi16( packed, _mm_srli_si128( packed, 8 ) ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = PackedNormal( normals.get( i ) );
+	}
+}
+
+void PackedNormal::unpack( const PackedNormal * packed, Vector3fArray & out )
+{
+	float * nx = out.x();
+	float * ny = out.y();
+	float * nz = out.z();
+	int count = out.size();
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+	const __m128 inverseScale = _mm_set1_ps( 1.0f / SNORM16_SCALE );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		// Each 32-bit lane holds one normal, x in the low half and y in the high half
+		__m128i normals = _mm_loadu_si128( reinterpret_cast<const __m128i *>( packed + i ) );
+		__m128 x = _mm_mul_ps( _mm_cvtepi32_ps( lowHalves( normals ) ), inverseScale );
+		__m128 y = _mm_mul_ps( _mm_cvtepi32_ps( highHalves( normals ) ), inverseScale );
+		__m128 z = _mm_sub_ps( _mm_sub_ps( one, _mm_andnot_ps( signMask, x ) ), _mm_andnot_ps( signMask, y ) );
+
+		// Move x and y towards 0 by the fold, which is 0 on the upper half
+		__m128 fold = _mm_max_ps( _mm_sub_ps( zero, z ), zero );
+		x = _mm_sub_ps( x, _mm_or_ps( fold, _mm_and_ps( signMask, x ) ) );
+		y = _mm_sub_ps( y, _mm_or_ps( fold, _mm_and_ps( signMask, y ) ) );
+
+		__m128 magnitude = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+		_mm_storeu_ps( nx + i, _mm_div_ps( x, magnitude ) );
+		_mm_storeu_ps( ny + i, _mm_div_ps( y, magnitude ) );
+		_mm_storeu_ps( nz + i, _mm_div_ps( z, magnitude ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out.set( i, packed[i].unpack() );
+	}
+}
+
+/***********************************************************
+ * PositionQuantizer Class Methods
+ **********************************************************/
+PositionQuantizer::PositionQuantizer( const Vector3f & cellOrigin, float cellSize ) :
+	mCellOrigin( cellOrigin ),
+	mCellSize( cellSize ),
+	mStep( cellSize / UNORM16_MAX ),
+	mInverseStep( UNORM16_MAX / cellSize )
+{
+}
+
+QuantizedPosition PositionQuantizer::pack( const Vector3f & position ) const
+{
+	Vector3f offset = ( position - mCellOrigin ) * mInverseStep;
+	uint16_t components[3];
+	for( int i = 0; i < 3; i++ )
+	{
+		float value = offset[i] < 0.0f ? 0.0f : ( offset[i] > UNORM16_MAX ? UNORM16_MAX : offset[i] );
+		components[i] = static_cast<uint16_t>( lrintf( value ) );
+	}
+
+	QuantizedPosition quantized = { components[0], components[1], components[2], 0 };
+	return quantized;
+}
+
+// SSE2 only has a signed 32 to 16-bit pack, so values are biased by -32768 before packing
+// and flipped back with the top bit afterwards
+void PositionQuantizer::pack( const Vector3fArray & positions, QuantizedPosition * out ) const
+{
+	const float * px = positions.x();
+	const float * py = positions.y();
+	const float * pz = positions.z();
+	int count = positions.size();
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 maximum = _mm_set1_ps( UNORM16_MAX );
+	const __m128 inverseStep = _mm_set1_ps( mInverseStep );
+	const __m128 originX = _mm_set1_ps( mCellOrigin[0] );
+	const __m128 originY = _mm_set1_ps( mCellOrigin[1] );
+	const __m128 originZ = _mm_set1_ps( mCellOrigin[2] );
+	const __m128i bias = _mm_set1_epi32( 32768 );
+	const __m128i topBit = _mm_set1_epi16( static_cast<short>( 0x8000 ) );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 x = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( px + i ), originX ), inverseStep );
+		__m128 y = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( py + i ), originY ), inverseStep );
+		__m128 z = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( pz + i ), originZ ), inverseStep );
+		x = _mm_min_ps( _mm_max_ps( x, zero ), maximum );
+		y = _mm_min_ps( _mm_max_ps( y, zero ), maximum );
+		z = _mm_min_ps( _mm_max_ps( z, zero ), maximum );
+
+		// Rows of x, y, z, padding become one row per position
+		__m128 row0 = _mm_castsi128_ps( _mm_sub_epi32( _mm_cvtps_epi32( x ), bias ) );
+		__m128 row1 = _mm_castsi128_ps( _mm_sub_epi32( _mm_cvtps_epi32( y ), bias ) );
+		__m128 row2 = _mm_castsi128_ps( _mm_sub_epi32( _mm_cvtps_epi32( z ), bias ) );
+		__m128 row3 = _mm_castsi128_ps( _mm_sub_epi32( _mm_setzero_si128(), bias ) );
+		_MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+
+		__m128i first = _mm_packs_epi32( _mm_castps_si128( row0 ), _mm_castps_si128( row1 ) );
+		__m128i second = _mm_packs_epi32( _mm_castps_si128( row2 ), _mm_castps_si128( row3 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( out + i ), _mm_xor_si128( first, topBit ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( out + i + 2 ), _mm_xor_si128( second, topBit ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = pack( positions.get( i ) );
+	}
+}
+
+void PositionQuantizer::unpack( const QuantizedPosition * quantized, Vector3fArray & out ) const
+{
+	float * px = out.x();
+	float * py = out.y();
+	float * pz = out.z();
+	int count = out.size();
+
+	const __m128 step = _mm_set1_ps( mStep );
+	const __m128 bias = _mm_set1_ps( 32768.0f );
+	const __m128 originX = _mm_set1_ps( mCellOrigin[0] );
+	const __m128 originY = _mm_set1_ps( mCellOrigin[1] );
+	const __m128 originZ = _mm_set1_ps( mCellOrigin[2] );
+	const __m128i topBit = _mm_set1_epi16( static_cast<short>( 0x8000 ) );
+
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i first = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i *>( quantized + i ) ), topBit );
+		__m128i second = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i *>( quantized + i + 2 ) ), topBit );
+
+		// Widen each position to a row of 4 ints, then transpose back to x, y, z rows
+		__m128 row0 = _mm_cvtepi32_ps( highHalves( _mm_unpacklo_epi16( first, first ) ) );
+		__m128 row1 = _mm_cvtepi32_ps( highHalves( _mm_unpackhi_epi16( first, first ) ) );
+		__m128 row2 = _mm_cvtepi32_ps( highHalves( _mm_unpacklo_epi16( second, second ) ) );
+		__m128 row3 = _mm_cvtepi32_ps( highHalves( _mm_unpackhi_epi16( second, second ) ) );
+		_MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+
+		_mm_storeu_ps( px + i, _mm_add_ps( originX, _mm_mul_ps( _mm_add_ps( row0, bias ), step ) ) );
+		_mm_storeu_ps( py + i, _mm_add_ps( originY, _mm_mul_ps( _mm_add_ps( row1, bias ), step ) ) );
+		_mm_storeu_ps( pz + i, _mm_add_ps( originZ, _mm_mul_ps( _mm_add_ps( row2, bias ), step ) ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out.set( i, unpack( quantized[i] ) );
+	}
+}
+
+/***********************************************************
+ * PackedQuaternion Class Methods
+ **********************************************************/
+PackedQuaternion::PackedQuaternion( const Quaternion & rotation ) :
+	mW( toSnorm16( rotation.w ) ),
+	mX( toSnorm16( rotation.x ) ),
+	mY( toSnorm16( rotation.y ) ),
+	mZ( toSnorm16( rotation.z ) )
+{
+}
+
+// Both types store w, x, y, z in order, so each Quaternion is one SSE register
+// and each PackedQuaternion is half of one
+void PackedQuaternion::pack( const Quaternion * rotations, PackedQuaternion * out, int count )
+{
+	static_assert( sizeof( Quaternion ) == 4 * sizeof( float ), "Quaternion should be 4 packed floats" );
+	static_assert( sizeof( PackedQuaternion ) == 4 * sizeof( int16_t ), "PackedQuaternion should be 4 packed shorts" );
+
+	const __m128 scale = _mm_set1_ps( SNORM16_SCALE );
+
+	int i = 0;
+	for( ; i + 2 <= count; i += 2 )
+	{
+		__m128i first = _mm_cvtps_epi32( _mm_mul_ps( _mm_loadu_ps( &rotations[i].w ), scale ) );
+		__m128i second = _mm_cvtps_epi32( _mm_mul_ps( _mm_loadu_ps( &rotations[i + 1].w ), scale ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( out + i ), _mm_packs_epi32( first, second ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = PackedQuaternion( rotations[i] );
+	}
+}
+
+void PackedQuaternion::unpack( const PackedQuaternion * packed, Quaternion * out, int count )
+{
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i first = _mm_loadu_si128( reinterpret_cast<const __m128i *>( packed + i ) );
+		__m128i second = _mm_loadu_si128( reinterpret_cast<const __m128i *>( packed + i + 2 ) );
+		__m128 w = _mm_cvtepi32_ps( highHalves( _mm_unpacklo_epi16( first, first ) ) );
+		__m128 x = _mm_cvtepi32_ps( highHalves( _mm_unpackhi_epi16( first, first ) ) );
+		__m128 y = _mm_cvtepi32_ps( highHalves( _mm_unpacklo_epi16( second, second ) ) );
+		__m128 z = _mm_cvtepi32_ps( highHalves( _mm_unpackhi_epi16( second, second ) ) );
+		_MM_TRANSPOSE4_PS( w, x, y, z );
+
+		// Normalizing takes care of the snorm scale too
+		__m128 magnitude = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( w, w ), _mm_mul_ps( x, x ) ), _mm_add_ps( _mm_mul_ps( y, y ), _mm_mul_ps( z, z ) ) ) );
+		w = _mm_div_ps( w, magnitude );
+		x = _mm_div_ps( x, magnitude );
+		y = _mm_div_ps( y, magnitude );
+		z = _mm_div_ps( z, magnitude );
+		_MM_TRANSPOSE4_PS( w, x, y, z );
+
+		float * outFloats = &out[i].w;
+		_mm_storeu_ps( outFloats, w );
+		_mm_storeu_ps( outFloats + 4, x );
+		_mm_storeu_ps( outFloats + 8, y );
+		_mm_storeu_ps( outFloats + 12, z );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = packed[i].unpack();
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef QUANTIZE_HPP
+#define QUANTIZE_HPP
+
+#include "Math.hpp"
+#include "Vector3fArray.hpp"
+#include <stdint.h>
+
+// Compact storage types for large sets of vectors that don't need full float precision.
+// Each has a scalar pack/unpack and a batch version working on a Vector3fArray (or an
+// array of Quaternions) that runs 4 at a time with SSE2. Every type here is tightly
+// packed, so arrays of them can be handed straight to glVertexAttribPointer().
+
+// Unit vector in 4 bytes, using the octahedral mapping: the vector is projected onto
+// the octahedron |x| + |y| + |z| = 1, the lower half is folded over the upper half, and
+// the resulting x and y are stored as 16-bit snorms. Max angular error is about 6e-5 radians.
+class PackedNormal
+{
+	public:
+		PackedNormal() : mX( 0 ), mY( 0 ) {};    // Unpacks to +z
+		explicit PackedNormal( const Vector3f & normal );
+
+		Vector3f unpack() const;
+
+		// out must have room for normals.size() entries
+		static void pack( const Vector3fArray & normals, PackedNormal * out );
+		// Unpacks out.size() normals
+		static void unpack( const PackedNormal * packed, Vector3fArray & out );
+
+	private:
+		int16_t mX;
+		int16_t mY;
+};
+
+// Position as 16-bit unsigned offsets from the minimum corner of a cell, see
+// PositionQuantizer. The fourth component pads it out to 8 bytes, so two fit in an SSE
+// register and it matches GL's 4 x GL_UNSIGNED_SHORT vertex format.
+struct QuantizedPosition
+{
+	uint16_t x;
+	uint16_t y;
+	uint16_t z;
+	uint16_t padding;
+};
+
+// Packs positions within a cube shaped cell into QuantizedPositions. The spacing of
+// the grid is cellSize / 65535, and positions outside the cell are clamped to its edges.
+class PositionQuantizer
+{
+	public:
+		PositionQuantizer( const Vector3f & cellOrigin, float cellSize );
+
+		Vector3f getCellOrigin() const { return mCellOrigin; };
+		float getCellSize() const { return mCellSize; };
+		// Largest distance between a position and its unpacked value, per component
+		float getMaxError() const { return 0.5f * mStep; };
+
+		QuantizedPosition pack( const Vector3f & position ) const;
+		Vector3f unpack( const QuantizedPosition & quantized ) const { return mCellOrigin + Vector3f( quantized.x, quantized.y, quantized.z ) * mStep; };
+
+		// out must have room for positions.size() entries
+		void pack( const Vector3fArray & positions, QuantizedPosition * out ) const;
+		// Unpacks out.size() positions
+		void unpack( const QuantizedPosition * quantized, Vector3fArray & out ) const;
+
+	private:
+		Vector3f mCellOrigin;
+		float    mCellSize;
+		float    mStep;           // Size of one quantization step
+		float    mInverseStep;
+};
+
+// Normalized quaternion as four 16-bit snorms, 8 bytes. Unpacking renormalizes, so the
+// rotation is off by no more than about 1e-4 radians.
+class PackedQuaternion
+{
+	public:
+		PackedQuaternion() : mW( 32767 ), mX( 0 ), mY( 0 ), mZ( 0 ) {};    // Identity
+		explicit PackedQuaternion( const Quaternion & rotation );
+
+		Quaternion unpack() const { return Quaternion( mW, mX, mY, mZ ); };    // Normalizing makes the scale irrelevant
+
+		static void pack( const Quaternion * rotations, PackedQuaternion * out, int count );
+		static void unpack( const PackedQuaternion * packed, Quaternion * out, int count );
+
+	private:
+		int16_t mW;
+		int16_t mX;
+		int16_t mY;
+		int16_t mZ;
+};
+
+#endif
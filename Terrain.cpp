@@ -5,29 +5,148 @@
 #include "Terrain.hpp"
 #include "Texture.hpp"
 #include "ImageLoader.hpp"
+#include "Vector3fArray.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+// Buffer objects are core since OpenGL 1.5, but only declared by glext.h
+#define GL_GLEXT_PROTOTYPES
 #include "GL/glut.h"
+#include <emmintrin.h>
 
-Terrain::Terrain( const std::string & heightmapFilename, const std::string & textureFilename, const float heightScale )
+// Height on a quad split along the diagonal from ( 0, 1 ) to ( 1, 0 ), the way the
+// triangle strips split them, at ( u, v ) within the quad
+static inline float interpolateTriangles( float height00, float height10, float height01, float height11, float u, float v )
 {
-	mTexture = new Texture( textureFilename );
+	if( u + v <= 1.0f )
+	{
+		return height00 + u * ( height10 - height00 ) + v * ( height01 - height00 );
+	}
+	return height11 + ( 1.0f - u ) * ( height01 - height11 ) + ( 1.0f - v ) * ( height10 - height11 );
+}
+
+// Quad under a point and where the point is within it, clamped to a map of
+// width x length samples. The batch version below clamps the same way.
+static inline void locateQuad( float x, float z, int width, int length, int & quadX, int & quadZ, float & u, float & v )
+{
+	x = std::min( std::max( x, 0.0f ), width - 1.0f );
+	z = std::min( std::max( z, 0.0f ), length - 1.0f );
+	float cornerX = std::min( static_cast<float>( static_cast<int>( x ) ), width - 2.0f );
+	float cornerZ = std::min( static_cast<float>( static_cast<int>( z ) ), length - 2.0f );
+	quadX = static_cast<int>( cornerX );
+	quadZ = static_cast<int>( cornerZ );
+	u = x - cornerX;
+	v = z - cornerZ;
+}
+
+// Four points at once: the heights at the corners of their quads, and where they are
+// within them. SSE2 has no gather, so the corners are loaded one at a time, then
+// scaled and offset in the same order as Terrain::getHeight().
+static inline void gatherQuads( const uint16_t * heightMap, float heightScale, float heightOffset, int width, int length, __m128 x, __m128 z, __m128 & u, __m128 & v, __m128 corners[4] )
+{
+	const __m128 zero = _mm_setzero_ps();
+	x = _mm_min_ps( _mm_max_ps( x, zero ), _mm_set1_ps( width - 1.0f ) );
+	z = _mm_min_ps( _mm_max_ps( z, zero ), _mm_set1_ps( length - 1.0f ) );
+	__m128 cornerX = _mm_min_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( x ) ), _mm_set1_ps( width - 2.0f ) );
+	__m128 cornerZ = _mm_min_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( z ) ), _mm_set1_ps( length - 2.0f ) );
+	u = _mm_sub_ps( x, cornerX );
+	v = _mm_sub_ps( z, cornerZ );
 
-	unsigned char *pixels = NULL;
-	loadBitmap( heightmapFilename, pixels, mWidth, mLength );
+	int quadX[4];
+	int quadZ[4];
+	_mm_storeu_si128( reinterpret_cast<__m128i *>( quadX ), _mm_cvttps_epi32( cornerX ) );
+	_mm_storeu_si128( reinterpret_cast<__m128i *>( quadZ ), _mm_cvttps_epi32( cornerZ ) );
+	const uint16_t *quads[4];
+	for( int i = 0; i < 4; i++ )
+	{
+		quads[i] = &heightMap[quadX[i] * length + quadZ[i]];
+	}
+	const int offsets[4] = { 0, length, 1, length + 1 };
+	const __m128 scale = _mm_set1_ps( heightScale );
+	const __m128 offset = _mm_set1_ps( heightOffset );
+	for( int i = 0; i < 4; i++ )
+	{
+		int o = offsets[i];
+		__m128 samples = _mm_setr_ps( quads[0][o], quads[1][o], quads[2][o], quads[3][o] );
+		corners[i] = _mm_add_ps( offset, _mm_mul_ps( samples, scale ) );
+	}
+}
 
-	mHeightMap = new float[mWidth * mLength];
-	for( int z = 0; z < mLength; z++ )
+// Narrows [enter, exit] to where the ray is over the rectangle, false if that leaves nothing
+static bool clipToRectangle( const Vector3f & origin, const Vector3f & direction, float minX, float maxX, float minZ, float maxZ, float & enter, float & exit )
+{
+	const int axes[2] = { 0, 2 };
+	const float minimums[2] = { minX, minZ };
+	const float maximums[2] = { maxX, maxZ };
+	for( int i = 0; i < 2; i++ )
 	{
-		for( int x = 0; x < mWidth; x++ )
+		int axis = axes[i];
+		if( direction[axis] == 0.0f )
 		{
-			// Only need one channel, arbitrarily take red channel
-			unsigned char color = pixels[3 * ( mWidth * x + z )];
-			// Varies from - height / 2 to height / 2
-			mHeightMap[mWidth * x + z] = heightScale * ( ( color / 255.0f ) - 0.5f );
+			if( origin[axis] < minimums[i] || origin[axis] > maximums[i] )
+			{
+				return false;
+			}
+			continue;
 		}
+
+		float inverseDirection = 1.0f / direction[axis];
+		float near = ( minimums[i] - origin[axis] ) * inverseDirection;
+		float far = ( maximums[i] - origin[axis] ) * inverseDirection;
+		enter = std::max( enter, std::min( near, far ) );
+		exit = std::min( exit, std::max( near, far ) );
 	}
+	return enter <= exit;
+}
+
+// Keeps the deepest MAX_CONTACT_POINTS contacts in the manifold, sorted deepest first,
+// with the normal of the deepest
+static void addContact( ContactManifold & manifold, float depths[], const Vector3f & point, float depth, const Vector3f & normal )
+{
+	if( manifold.numPoints == MAX_CONTACT_POINTS && depth <= depths[MAX_CONTACT_POINTS - 1] )
+	{
+		return;
+	}
+
+	int i = std::min( manifold.numPoints, MAX_CONTACT_POINTS - 1 );
+	for( ; i > 0 && depths[i - 1] < depth; i-- )
+	{
+		depths[i] = depths[i - 1];
+		manifold.points[i] = manifold.points[i - 1];
+	}
+	depths[i] = depth;
+	manifold.points[i] = point;
+	manifold.numPoints = std::min( manifold.numPoints + 1, MAX_CONTACT_POINTS );
+
+	if( i == 0 )
+	{
+		manifold.normal = normal;
+		manifold.penetrationDepth = depth;
+	}
+}
+
+// Selects a where mask is set, b elsewhere
+static inline __m128 select( __m128 mask, __m128 a, __m128 b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+Terrain::Terrain( const std::string & heightmapFilename, const std::string & textureFilename, const float heightScale )
+{
+	mTexture = new Texture( textureFilename );
 
+	// Rows of the file run along x and its columns along z, so the heightmap is stored
+	// x * mLength + z the same as the file
+	loadHeightmap( heightmapFilename, mHeightMap, mLength, mWidth );
+	// Varies from - height / 2 to height / 2
+	mHeightScale = heightScale / 65535.0f;
+	mHeightOffset = -0.5f * heightScale;
+
+	mHeightPyramid.build( mHeightMap, mWidth, mLength, mHeightScale, mHeightOffset );
 	computeNormals();
-	buildDisplayList();
+	buildBuffers();
 }
 
 Terrain::~Terrain()
@@ -35,134 +154,891 @@ Terrain::~Terrain()
 	delete [] mHeightMap;
 	delete [] mNormals;
 	delete mTexture;
+
+	glDeleteBuffers( 1, &mVertexBuffer );
+	glDeleteBuffers( 1, &mIndexBuffer );
 }
 
 void Terrain::render() const
 {
-	glCallList( mDisplayListHandle );
+	mVisibleChunks.resize( mChunks.size() );
+	for( unsigned int i = 0; i < mChunks.size(); i++ )
+	{
+		mVisibleChunks[i] = i;
+	}
+	renderChunks( mVisibleChunks );
 }
 
-void Terrain::buildDisplayList()
+void Terrain::render( const Frustum & frustum ) const
 {
-	mDisplayListHandle = glGenLists( 1 );
+	getVisibleChunks( frustum, mVisibleChunks );
+	renderChunks( mVisibleChunks );
+}
 
-	glNewList( mDisplayListHandle, GL_COMPILE );
-		mTexture->bind();
+void Terrain::getVisibleChunks( const Frustum & frustum, std::vector<int> & visibleChunks ) const
+{
+	visibleChunks.clear();
+	for( unsigned int i = 0; i < mChunks.size(); i++ )
+	{
+		if( frustum.isAxisAlignedBoxInFrustum( mChunks[i].minCorner, mChunks[i].maxCorner ) )
+		{
+			visibleChunks.push_back( i );
+		}
+	}
+}
+
+// Geomipmapping: a level's error in pixels is its geometric error scaled by how many
+// pixels a unit covers at the chunk's distance. As that error for the next coarser
+// level falls from twice the limit to the limit, the samples it would drop are morphed
+// onto its triangles, so the switch to it changes nothing on screen.
+void Terrain::updateLevelOfDetail( const Frustum & frustum, int viewportWidth )
+{
+	float pixelsPerUnit = viewportWidth / ( 2.0f * tan( 0.5f * frustum.getFov() * PI_OVER_180 ) );
+	Vector3f eye = frustum.getPosition();
 
-		// Texturing quads (each of which is 2 triangles) is a lot easier than
-		// texturing triangles themselves. Texture a square group of quads, where
-		// the reciprocal of the delta below is the number of quads along one edge
-		// of the square.
-		float textureXCoord = 0.0f;
-		float textureYCoord = 0.0f;
-		float textureCoordDelta = 0.1f;
+	std::vector<TerrainVertex> vertices;
+	glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+
+	getVisibleChunks( frustum, mVisibleChunks );
+	for( unsigned int i = 0; i < mVisibleChunks.size(); i++ )
+	{
+		TerrainChunk & chunk = mChunks[mVisibleChunks[i]];
 
-		for( int z = 0; z < mLength - 1; z++ )
+		// Distance to the closest point of the chunk's bounding box
+		Vector3f closest;
+		for( int axis = 0; axis < 3; axis++ )
 		{
-			glBegin( GL_TRIANGLE_STRIP );
-			for( int x = 0; x < mWidth; x++ )
-			{
-				Vector3f normal = mNormals[x * mWidth + z];
-				glNormal3f( normal[0], normal[1], normal[2] );
-				glTexCoord2f( textureXCoord, textureYCoord );
-				glVertex3f( x, mHeightMap[mWidth * x + z], z );
+			closest[axis] = std::max( chunk.minCorner[axis], std::min( eye[axis], chunk.maxCorner[axis] ) );
+		}
+		float pixelsPerError = pixelsPerUnit / std::max( ( closest - eye ).magnitude(), 1.0f );
+
+		int level = 0;
+		while( level + 1 < chunk.levelCount && chunk.geometricError[level + 1] * pixelsPerError <= TERRAIN_MAX_SCREEN_ERROR )
+		{
+			level++;
+		}
+
+		int morphStep = 0;
+		if( level + 1 < chunk.levelCount )
+		{
+			float nextError = chunk.geometricError[level + 1] * pixelsPerError;
+			float morph = ( 2.0f * TERRAIN_MAX_SCREEN_ERROR - nextError ) / TERRAIN_MAX_SCREEN_ERROR;
+			morphStep = static_cast<int>( std::max( 0.0f, std::min( morph, 1.0f ) ) * TERRAIN_MORPH_STEPS + 0.5f );
+		}
+		chunk.level = level;
+
+		// Unmorphed vertices are the same for every level
+		int morphedLevel = morphStep > 0 ? level : -1;
+		if( morphedLevel != chunk.uploadedLevel || morphStep != chunk.uploadedMorph )
+		{
+			fillChunkVertices( chunk, level, static_cast<float>( morphStep ) / TERRAIN_MORPH_STEPS, vertices );
+			glBufferSubData( GL_ARRAY_BUFFER, chunk.firstVertex * sizeof( TerrainVertex ), chunk.vertexCount * sizeof( TerrainVertex ), &vertices[0] );
+			chunk.uploadedLevel = morphedLevel;
+			chunk.uploadedMorph = morphStep;
+		}
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
 
-				normal = mNormals[x * mWidth + ( z + 1 )];
-				glNormal3f( normal[0], normal[1], normal[2] );
-				glTexCoord2f( textureXCoord, textureYCoord + 0.25f );
-				glVertex3f( x, mHeightMap[mWidth * x + ( z + 1 )], z + 1 );
+int Terrain::getTriangleCount( const std::vector<int> & chunks ) const
+{
+	int triangles = 0;
+	for( unsigned int i = 0; i < chunks.size(); i++ )
+	{
+		const TerrainChunk & chunk = mChunks[chunks[i]];
+		triangles += chunk.indexCount[chunk.level] - 2;
+	}
+	return triangles;
+}
+
+float Terrain::sampleHeight( float x, float z ) const
+{
+	int quadX, quadZ;
+	float u, v;
+	locateQuad( x, z, mWidth, mLength, quadX, quadZ, u, v );
+	return interpolateTriangles( getHeight( quadX, quadZ ), getHeight( quadX + 1, quadZ ), getHeight( quadX, quadZ + 1 ), getHeight( quadX + 1, quadZ + 1 ), u, v );
+}
+
+// Quads are one unit across, so the slopes along x and z are just height differences
+Vector3f Terrain::sampleNormal( float x, float z ) const
+{
+	int quadX, quadZ;
+	float u, v;
+	locateQuad( x, z, mWidth, mLength, quadX, quadZ, u, v );
+	float height00 = getHeight( quadX, quadZ );
+	float height10 = getHeight( quadX + 1, quadZ );
+	float height01 = getHeight( quadX, quadZ + 1 );
+	float height11 = getHeight( quadX + 1, quadZ + 1 );
 
-				textureXCoord += textureCoordDelta;
+	if( u + v <= 1.0f )
+	{
+		return Vector3f( height00 - height10, 1.0f, height00 - height01 ).normalize();
+	}
+	return Vector3f( height01 - height11, 1.0f, height10 - height11 ).normalize();
+}
+
+void Terrain::sampleHeights( const Vector3fArray & positions, float * out ) const
+{
+	const float *px = positions.x();
+	const float *pz = positions.z();
+	int count = positions.size();
+
+	const __m128 one = _mm_set1_ps( 1.0f );
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 u, v;
+		__m128 corners[4];
+		gatherQuads( mHeightMap, mHeightScale, mHeightOffset, mWidth, mLength, _mm_loadu_ps( px + i ), _mm_loadu_ps( pz + i ), u, v, corners );
+
+		// Same operations as interpolateTriangles(), both triangles then a select
+		__m128 lower = _mm_add_ps( _mm_add_ps( corners[0], _mm_mul_ps( u, _mm_sub_ps( corners[1], corners[0] ) ) ), _mm_mul_ps( v, _mm_sub_ps( corners[2], corners[0] ) ) );
+		__m128 upper = _mm_add_ps( _mm_add_ps( corners[3], _mm_mul_ps( _mm_sub_ps( one, u ), _mm_sub_ps( corners[2], corners[3] ) ) ), _mm_mul_ps( _mm_sub_ps( one, v ), _mm_sub_ps( corners[1], corners[3] ) ) );
+		_mm_storeu_ps( out + i, select( _mm_cmple_ps( _mm_add_ps( u, v ), one ), lower, upper ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = sampleHeight( px[i], pz[i] );
+	}
+}
+
+void Terrain::sampleNormals( const Vector3fArray & positions, Vector3fArray & out ) const
+{
+	const float *px = positions.x();
+	const float *pz = positions.z();
+	float *ox = out.x();
+	float *oy = out.y();
+	float *oz = out.z();
+	int count = positions.size();
+
+	const __m128 one = _mm_set1_ps( 1.0f );
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 u, v;
+		__m128 corners[4];
+		gatherQuads( mHeightMap, mHeightScale, mHeightOffset, mWidth, mLength, _mm_loadu_ps( px + i ), _mm_loadu_ps( pz + i ), u, v, corners );
+
+		__m128 isLower = _mm_cmple_ps( _mm_add_ps( u, v ), one );
+		__m128 x = select( isLower, _mm_sub_ps( corners[0], corners[1] ), _mm_sub_ps( corners[2], corners[3] ) );
+		__m128 z = select( isLower, _mm_sub_ps( corners[0], corners[2] ), _mm_sub_ps( corners[1], corners[3] ) );
+		__m128 magnitude = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), one ), _mm_mul_ps( z, z ) ) );
+		_mm_storeu_ps( ox + i, _mm_div_ps( x, magnitude ) );
+		_mm_storeu_ps( oy + i, _mm_div_ps( one, magnitude ) );
+		_mm_storeu_ps( oz + i, _mm_div_ps( z, magnitude ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out.set( i, sampleNormal( px[i], pz[i] ) );
+	}
+}
+
+// Two kinds of contact: corners of the box below the surface, pushed out along the
+// normal of the triangle above them, and heightmap samples inside the box, pushed out
+// along their normal until they're past the box's lowest point in that direction
+bool Terrain::collide( const OrientedBoundingBox & box, ContactManifold & manifold ) const
+{
+	manifold.numPoints = 0;
+	manifold.penetrationDepth = 0.0f;
+	for( int i = 0; i < MAX_CONTACT_POINTS; i++ )
+	{
+		manifold.normalImpulses[i] = 0.0f;
+	}
+
+	Vector3f corners[8];
+	Vector3f axes[3];
+	OrientedBoundingBox::calculateCornerPoints( corners, box.getCenter(), box.getEdgeHalfLengths(), box.getOrientation() );
+	OrientedBoundingBox::calculateOrthogonalAxes( axes, box.getOrientation() );
+
+	Vector3f minCorner = corners[0];
+	Vector3f maxCorner = corners[0];
+	for( int i = 1; i < 8; i++ )
+	{
+		for( int axis = 0; axis < 3; axis++ )
+		{
+			minCorner[axis] = std::min( minCorner[axis], corners[i][axis] );
+			maxCorner[axis] = std::max( maxCorner[axis], corners[i][axis] );
+		}
+	}
+
+	// Samples under the footprint, empty if the box is off the map
+	int startX = std::max( static_cast<int>( floor( minCorner[0] ) ), 0 );
+	int startZ = std::max( static_cast<int>( floor( minCorner[2] ) ), 0 );
+	int endX = std::min( static_cast<int>( ceil( maxCorner[0] ) ), mWidth - 1 );
+	int endZ = std::min( static_cast<int>( ceil( maxCorner[2] ) ), mLength - 1 );
+	if( startX > endX || startZ > endZ )
+	{
+		return false;
+	}
+
+	// Nothing to do for boxes above the highest quad under them, the usual case.
+	// The quads are widened to at least one, for footprints on the last sample.
+	float minHeight, maxHeight;
+	mHeightPyramid.getHeightRange( std::min( startX, mWidth - 2 ), std::min( startZ, mLength - 2 ), std::max( endX, startX + 1 ), std::max( endZ, startZ + 1 ), minHeight, maxHeight );
+	if( minCorner[1] > maxHeight )
+	{
+		return false;
+	}
+
+	float depths[MAX_CONTACT_POINTS];
+	for( int i = 0; i < 8; i++ )
+	{
+		const Vector3f & corner = corners[i];
+		if( corner[0] < 0.0f || corner[0] > mWidth - 1 || corner[2] < 0.0f || corner[2] > mLength - 1 )
+		{
+			continue;
+		}
+
+		float height = sampleHeight( corner[0], corner[2] );
+		if( corner[1] < height )
+		{
+			// Distance to the triangle's plane, rather than straight down to it
+			Vector3f normal = sampleNormal( corner[0], corner[2] );
+			addContact( manifold, depths, corner, ( height - corner[1] ) * normal[1], normal );
+		}
+	}
+
+	Vector3f center = box.getCenter();
+	Vector3f halfLengths = box.getEdgeHalfLengths();
+	for( int x = startX; x <= endX; x++ )
+	{
+		for( int z = startZ; z <= endZ; z++ )
+		{
+			Vector3f sample( x, getHeight( x, z ), z );
+			if( sample[1] < minCorner[1] || sample[1] > maxCorner[1] || !box.isPointInside( sample ) )
+			{
+				continue;
 			}
-			glEnd();
 
-			textureYCoord += textureCoordDelta;
+			Vector3f normal = getNormal( x, z );
+			float lowest = center.dot( normal );
+			for( int axis = 0; axis < 3; axis++ )
+			{
+				lowest -= halfLengths[axis] * fabs( axes[axis].dot( normal ) );
+			}
+			addContact( manifold, depths, sample, sample.dot( normal ) - lowest, normal );
 		}
-	glEndList();
+	}
+
+	return manifold.numPoints > 0;
 }
 
-void Terrain::computeNormals()
+bool Terrain::raycast( const Vector3f & origin, const Vector3f & direction, float maxDistance, float & distance ) const
+{
+	float enter = 0.0f;
+	float exit = maxDistance;
+	if( mHeightPyramid.getLevelCount() == 0 || !clipToRectangle( origin, direction, 0.0f, mWidth - 1.0f, 0.0f, mLength - 1.0f, enter, exit ) )
+	{
+		return false;
+	}
+	return raycastNode( mHeightPyramid.getLevelCount() - 1, 0, 0, origin, direction, enter, exit, distance );
+}
+
+bool Terrain::raycastNode( int level, int x, int z, const Vector3f & origin, const Vector3f & direction, float enter, float exit, float & distance ) const
 {
-	Vector3f *tempNormals = new Vector3f[mWidth * mLength];
-	for( int x = 0; x < mWidth; x++ )
+	float enterHeight = origin[1] + direction[1] * enter;
+	float exitHeight = origin[1] + direction[1] * exit;
+	if( std::min( enterHeight, exitHeight ) > mHeightPyramid.getMaxHeight( level, x, z ) || std::max( enterHeight, exitHeight ) < mHeightPyramid.getMinHeight( level, x, z ) )
+	{
+		return false;
+	}
+	if( level == 0 )
+	{
+		return raycastQuad( x, z, origin, direction, enter, exit, distance );
+	}
+
+	// Children don't overlap, so a hit in one is nearer than any in the ones it crosses after
+	int childSize = 1 << ( level - 1 );
+	int childCount = 0;
+	int childXs[4];
+	int childZs[4];
+	float childEnters[4];
+	float childExits[4];
+	for( int childX = 2 * x; childX < std::min( 2 * x + 2, mHeightPyramid.getLevelWidth( level - 1 ) ); childX++ )
 	{
-		for( int z = 0; z < mLength; z++ )
+		for( int childZ = 2 * z; childZ < std::min( 2 * z + 2, mHeightPyramid.getLevelLength( level - 1 ) ); childZ++ )
 		{
-			Vector3f sum( 0.0f, 0.0f, 0.0f );
+			float childEnter = enter;
+			float childExit = exit;
+			float minX = childX * childSize;
+			float minZ = childZ * childSize;
+			float maxX = std::min( minX + childSize, mWidth - 1.0f );
+			float maxZ = std::min( minZ + childSize, mLength - 1.0f );
+			if( !clipToRectangle( origin, direction, minX, maxX, minZ, maxZ, childEnter, childExit ) )
+			{
+				continue;
+			}
 
-			Vector3f left( 0.0f, 0.0f, 0.0f );
-			if( x > 0 )
+			int i = childCount++;
+			for( ; i > 0 && childEnters[i - 1] > childEnter; i-- )
 			{
-				left = Vector3f( -1.0, this->getHeight( x - 1, z ) - this->getHeight( x, z ), 0.0f );
+				childXs[i] = childXs[i - 1];
+				childZs[i] = childZs[i - 1];
+				childEnters[i] = childEnters[i - 1];
+				childExits[i] = childExits[i - 1];
 			}
+			childXs[i] = childX;
+			childZs[i] = childZ;
+			childEnters[i] = childEnter;
+			childExits[i] = childExit;
+		}
+	}
+
+	for( int i = 0; i < childCount; i++ )
+	{
+		if( raycastNode( level - 1, childXs[i], childZs[i], origin, direction, childEnters[i], childExits[i], distance ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Intersects the planes of the quad's two triangles, split the same way as
+// interpolateTriangles(), and keeps the nearest hit inside its own triangle
+bool Terrain::raycastQuad( int x, int z, const Vector3f & origin, const Vector3f & direction, float enter, float exit, float & distance ) const
+{
+	// Slack for hits on the edges shared with the neighboring quads
+	const float tolerance = 1e-4f;
 
-			Vector3f right( 0.0f, 0.0f, 0.0f );
-			if( x < mWidth - 1 )
+	float height00 = getHeight( x, z );
+	float height10 = getHeight( x + 1, z );
+	float height01 = getHeight( x, z + 1 );
+	float height11 = getHeight( x + 1, z + 1 );
+
+	// Each plane as height = cornerHeight + ( px - cornerX ) * slopeX + ( pz - cornerZ ) * slopeZ
+	const float cornerXs[2] = { static_cast<float>( x ), x + 1.0f };
+	const float cornerZs[2] = { static_cast<float>( z ), z + 1.0f };
+	const float cornerHeights[2] = { height00, height11 };
+	const float slopeXs[2] = { height10 - height00, height11 - height01 };
+	const float slopeZs[2] = { height01 - height00, height11 - height10 };
+
+	bool isHit = false;
+	for( int triangle = 0; triangle < 2; triangle++ )
+	{
+		float offsetX = origin[0] - cornerXs[triangle];
+		float offsetZ = origin[2] - cornerZs[triangle];
+		float above = origin[1] - cornerHeights[triangle] - offsetX * slopeXs[triangle] - offsetZ * slopeZs[triangle];
+		float rate = direction[1] - direction[0] * slopeXs[triangle] - direction[2] * slopeZs[triangle];
+		if( rate == 0.0f )
+		{
+			continue;
+		}
+
+		float t = -above / rate;
+		if( t < enter - tolerance || t > exit + tolerance || ( isHit && t >= distance ) )
+		{
+			continue;
+		}
+
+		float u = origin[0] + direction[0] * t - x;
+		float v = origin[2] + direction[2] * t - z;
+		bool isInTriangle = triangle == 0 ? u + v <= 1.0f + tolerance : u + v >= 1.0f - tolerance;
+		if( isInTriangle )
+		{
+			distance = std::max( t, enter );
+			isHit = true;
+		}
+	}
+	return isHit;
+}
+
+void Terrain::renderChunks( const std::vector<int> & chunks ) const
+{
+	if( chunks.empty() )
+	{
+		return;
+	}
+
+	// Each chunk is its own strip, so they can't be drawn as one range of indices
+	std::vector<GLsizei> counts( chunks.size() );
+	std::vector<const GLvoid *> offsets( chunks.size() );
+	for( unsigned int i = 0; i < chunks.size(); i++ )
+	{
+		const TerrainChunk & chunk = mChunks[chunks[i]];
+		counts[i] = chunk.indexCount[chunk.level];
+		offsets[i] = reinterpret_cast<const GLvoid *>( chunk.firstIndex[chunk.level] * sizeof( unsigned int ) );
+	}
+
+	mTexture->bind();
+
+	glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_NORMAL_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, position ) ) );
+	glNormalPointer( GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, normal ) ) );
+	glTexCoordPointer( 2, GL_FLOAT, sizeof( TerrainVertex ), reinterpret_cast<const GLvoid *>( offsetof( TerrainVertex, texCoord ) ) );
+
+	glMultiDrawElements( GL_TRIANGLE_STRIP, &counts[0], GL_UNSIGNED_INT, &offsets[0], chunks.size() );
+
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void Terrain::buildBuffers()
+{
+	std::vector<TerrainVertex> vertices;
+	std::vector<TerrainVertex> chunkVertices;
+	std::vector<unsigned int> indices;
+
+	for( int chunkX = 0; chunkX < mWidth - 1; chunkX += TERRAIN_CHUNK_SIZE )
+	{
+		for( int chunkZ = 0; chunkZ < mLength - 1; chunkZ += TERRAIN_CHUNK_SIZE )
+		{
+			TerrainChunk chunk;
+			chunk.startX = chunkX;
+			chunk.startZ = chunkZ;
+			chunk.endX = std::min( chunkX + TERRAIN_CHUNK_SIZE, mWidth - 1 );
+			chunk.endZ = std::min( chunkZ + TERRAIN_CHUNK_SIZE, mLength - 1 );
+			chunk.level = 0;
+			chunk.uploadedLevel = -1;
+			chunk.uploadedMorph = 0;
+
+			// Chunks cut short by the edge of the map may be too small for the coarsest levels
+			int size = std::min( chunk.endX - chunk.startX, chunk.endZ - chunk.startZ );
+			chunk.levelCount = 1;
+			while( chunk.levelCount < TERRAIN_LOD_LEVELS && ( 1 << chunk.levelCount ) <= size )
 			{
-				right = Vector3f( 1.0, this->getHeight( x + 1, z ) - this->getHeight( x, z ), 0.0f );
+				chunk.levelCount++;
 			}
 
-			Vector3f out( 0.0f, 0.0f, 0.0f );
-			if( z > 0 )
+			computeChunkBounds( chunk );
+
+			fillChunkVertices( chunk, 0, 0.0f, chunkVertices );
+			chunk.firstVertex = vertices.size();
+			chunk.vertexCount = chunkVertices.size();
+			vertices.insert( vertices.end(), chunkVertices.begin(), chunkVertices.end() );
+
+			for( int level = 0; level < chunk.levelCount; level++ )
 			{
-				out = Vector3f( 0.0f, this->getHeight( x, z - 1 ) - this->getHeight( x, z ), -1.0f );
+				chunk.firstIndex[level] = indices.size();
+				buildChunkIndices( chunk, level, indices );
+				chunk.indexCount[level] = indices.size() - chunk.firstIndex[level];
 			}
 
-			Vector3f in( 0, 0, 0 );
-			if( z < mLength - 1 )
+			mChunks.push_back( chunk );
+		}
+	}
+
+	glGenBuffers( 1, &mVertexBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+	// Dynamic, since chunks are re-uploaded as they geomorph
+	glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof( TerrainVertex ), &vertices[0], GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	glGenBuffers( 1, &mIndexBuffer );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( unsigned int ), &indices[0], GL_STATIC_DRAW );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+}
+
+void Terrain::computeChunkBounds( TerrainChunk & chunk ) const
+{
+	float minHeight, maxHeight;
+	mHeightPyramid.getHeightRange( chunk.startX, chunk.startZ, chunk.endX, chunk.endZ, minHeight, maxHeight );
+	for( int level = 0; level < chunk.levelCount; level++ )
+	{
+		chunk.geometricError[level] = 0.0f;
+	}
+	for( int x = chunk.startX; x <= chunk.endX; x++ )
+	{
+		for( int z = chunk.startZ; z <= chunk.endZ; z++ )
+		{
+			float height = getHeight( x, z );
+			for( int level = 1; level < chunk.levelCount; level++ )
 			{
-				in = Vector3f( 0.0f, this->getHeight( x, z + 1 ) - this->getHeight( x, z ), 1.0f );
+				float error = fabs( height - getLevelHeight( chunk, level, x, z ) );
+				chunk.geometricError[level] = std::max( chunk.geometricError[level], error );
 			}
+		}
+	}
+	// Coarser levels are never more accurate than finer ones
+	for( int level = 1; level < chunk.levelCount; level++ )
+	{
+		chunk.geometricError[level] = std::max( chunk.geometricError[level], chunk.geometricError[level - 1] );
+	}
+
+	// A crack along an edge can't be deeper than the heights along it vary, which
+	// is at most the chunk's height range
+	chunk.skirtDepth = maxHeight - minHeight + 1.0f;
+	chunk.minCorner = Vector3f( chunk.startX, minHeight - chunk.skirtDepth, chunk.startZ );
+	chunk.maxCorner = Vector3f( chunk.endX, maxHeight, chunk.endZ );
+}
+
+// A sample's smoothed normal depends on its neighbors' face normals, which depend on
+// their neighbors' heights, so normals up to two samples outside the rectangle change.
+// Chunks are re-uploaded whole, at the level and morph they already had, since their
+// skirts depend on their height range.
+void Terrain::updateRegion( int startX, int startZ, int endX, int endZ )
+{
+	mHeightPyramid.update( mHeightMap, startX, startZ, endX, endZ );
+
+	startX = std::max( startX - 2, 0 );
+	startZ = std::max( startZ - 2, 0 );
+	endX = std::min( endX + 2, mWidth - 1 );
+	endZ = std::min( endZ + 2, mLength - 1 );
+	computeNormalRows( startX, endX + 1, startZ, endZ + 1 );
+
+	std::vector<TerrainVertex> vertices;
+	glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+	for( unsigned int i = 0; i < mChunks.size(); i++ )
+	{
+		TerrainChunk & chunk = mChunks[i];
+		if( chunk.startX > endX || chunk.endX < startX || chunk.startZ > endZ || chunk.endZ < startZ )
+		{
+			continue;
+		}
+
+		computeChunkBounds( chunk );
+		fillChunkVertices( chunk, std::max( chunk.uploadedLevel, 0 ), static_cast<float>( chunk.uploadedMorph ) / TERRAIN_MORPH_STEPS, vertices );
+		glBufferSubData( GL_ARRAY_BUFFER, chunk.firstVertex * sizeof( TerrainVertex ), chunk.vertexCount * sizeof( TerrainVertex ), &vertices[0] );
+	}
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+// Next sample along an edge of size quads kept by a level, which keeps every step-th
+// sample plus the last one. Returns size + 1 after the last.
+static int getNextLevelSample( int sample, int step, int size )
+{
+	return sample == size ? size + 1 : std::min( sample + step, size );
+}
+
+// One strip per row of the level's grid, zig-zagging between z and z + step.
+// Repeating the last index of a row and the first of the next joins them with
+// degenerate triangles. The four skirts follow, joined the same way, each one
+// zig-zagging between an edge sample and the skirt vertex below it.
+void Terrain::buildChunkIndices( const TerrainChunk & chunk, int level, std::vector<unsigned int> & indices ) const
+{
+	int step = 1 << level;
+	int sizeX = chunk.endX - chunk.startX;
+	int sizeZ = chunk.endZ - chunk.startZ;
+	int rowLength = sizeZ + 1;
+	unsigned int base = chunk.firstVertex;
+	unsigned int skirtBase = base + ( sizeX + 1 ) * rowLength;
+	bool isFirstStrip = true;
+
+	for( int z = 0; z < sizeZ; z = getNextLevelSample( z, step, sizeZ ) )
+	{
+		if( !isFirstStrip )
+		{
+			indices.push_back( indices.back() );
+			indices.push_back( base + z );
+		}
+		isFirstStrip = false;
+
+		int nextZ = getNextLevelSample( z, step, sizeZ );
+		for( int x = 0; x <= sizeX; x = getNextLevelSample( x, step, sizeX ) )
+		{
+			indices.push_back( base + x * rowLength + z );
+			indices.push_back( base + x * rowLength + nextZ );
+		}
+	}
+
+	// Edges at z = start and z = end run along x, edges at x = start and x = end along z
+	for( int edge = 0; edge < 4; edge++ )
+	{
+		bool isAlongX = edge < 2;
+		int edgeSize = isAlongX ? sizeX : sizeZ;
+		unsigned int edgeSkirtBase = skirtBase + ( edge == 1 ? sizeX + 1 : 0 ) + ( edge == 2 ? 2 * ( sizeX + 1 ) : 0 ) + ( edge == 3 ? 2 * ( sizeX + 1 ) + sizeZ + 1 : 0 );
 
-			if( x > 0 && z > 0 )
+		for( int i = 0; i <= edgeSize; i = getNextLevelSample( i, step, edgeSize ) )
+		{
+			unsigned int gridIndex;
+			switch( edge )
 			{
-				sum += out.cross( left ).normalize();
+				case 0:  gridIndex = base + i * rowLength; break;
+				case 1:  gridIndex = base + i * rowLength + sizeZ; break;
+				case 2:  gridIndex = base + i; break;
+				default: gridIndex = base + sizeX * rowLength + i; break;
 			}
-			if( x > 0 && z < mLength - 1 )
+
+			if( i == 0 )
 			{
-				sum += left.cross( in ).normalize();
+				indices.push_back( indices.back() );
+				indices.push_back( gridIndex );
 			}
-			if( x < mWidth - 1 && z < mLength - 1 )
+			indices.push_back( gridIndex );
+			indices.push_back( edgeSkirtBase + i );
+		}
+	}
+}
+
+// Each quad of a level is split along the diagonal from ( x, z + step ) to ( x + step, z ),
+// the same way the strips split them. The last quad along an edge is narrower when the
+// step doesn't divide the chunk's size.
+float Terrain::getLevelHeight( const TerrainChunk & chunk, int level, int x, int z ) const
+{
+	int step = 1 << level;
+	int cellX = chunk.startX + ( std::min( x, chunk.endX - 1 ) - chunk.startX ) / step * step;
+	int cellZ = chunk.startZ + ( std::min( z, chunk.endZ - 1 ) - chunk.startZ ) / step * step;
+	int cellEndX = std::min( cellX + step, chunk.endX );
+	int cellEndZ = std::min( cellZ + step, chunk.endZ );
+
+	float u = static_cast<float>( x - cellX ) / ( cellEndX - cellX );
+	float v = static_cast<float>( z - cellZ ) / ( cellEndZ - cellZ );
+	return interpolateTriangles( getHeight( cellX, cellZ ), getHeight( cellEndX, cellZ ), getHeight( cellX, cellEndZ ), getHeight( cellEndX, cellEndZ ), u, v );
+}
+
+void Terrain::fillChunkVertices( const TerrainChunk & chunk, int level, float morph, std::vector<TerrainVertex> & vertices ) const
+{
+	// Texturing quads (each of which is 2 triangles) is a lot easier than
+	// texturing triangles themselves. Texture a square group of quads, where
+	// the reciprocal of the delta below is the number of quads along one edge
+	// of the square. Vertices are shared by the rows on both sides of them,
+	// so their coordinates come straight from their grid position.
+	float textureCoordDelta = 0.1f;
+
+	int sizeX = chunk.endX - chunk.startX;
+	int sizeZ = chunk.endZ - chunk.startZ;
+	int rowLength = sizeZ + 1;
+	int gridCount = ( sizeX + 1 ) * rowLength;
+	vertices.resize( gridCount + 2 * ( sizeX + 1 ) + 2 * ( sizeZ + 1 ) );
+
+	int step = 1 << level;
+	bool isMorphing = morph > 0.0f && level + 1 < chunk.levelCount;
+	for( int x = chunk.startX; x <= chunk.endX; x++ )
+	{
+		for( int z = chunk.startZ; z <= chunk.endZ; z++ )
+		{
+			int localX = x - chunk.startX;
+			int localZ = z - chunk.startZ;
+			float height = getHeight( x, z );
+
+			// Samples this level keeps but the next one drops. Every level keeps the last samples.
+			bool isOnLevel = ( localX % step == 0 || x == chunk.endX ) && ( localZ % step == 0 || z == chunk.endZ );
+			bool isOnNextLevel = ( localX % ( 2 * step ) == 0 || x == chunk.endX ) && ( localZ % ( 2 * step ) == 0 || z == chunk.endZ );
+			if( isMorphing && isOnLevel && !isOnNextLevel )
 			{
-				sum += in.cross( right ).normalize();
+				height += ( getLevelHeight( chunk, level + 1, x, z ) - height ) * morph;
 			}
-			if( x< mWidth - 1 && z > 0 )
+
+			Vector3f normal = getNormal( x, z );
+			TerrainVertex vertex = { { static_cast<float>( x ), height, static_cast<float>( z ) },
+			                         { normal[0], normal[1], normal[2] },
+			                         { x * textureCoordDelta, z * textureCoordDelta } };
+			vertices[localX * rowLength + localZ] = vertex;
+		}
+	}
+
+	// Skirts, in the same edge order as buildChunkIndices()
+	int skirtIndex = gridCount;
+	for( int edge = 0; edge < 4; edge++ )
+	{
+		int edgeSize = edge < 2 ? sizeX : sizeZ;
+		for( int i = 0; i <= edgeSize; i++ )
+		{
+			int gridIndex;
+			switch( edge )
 			{
-				sum += right.cross( out ).normalize();
+				case 0:  gridIndex = i * rowLength; break;
+				case 1:  gridIndex = i * rowLength + sizeZ; break;
+				case 2:  gridIndex = i; break;
+				default: gridIndex = sizeX * rowLength + i; break;
 			}
 
-			tempNormals[x * mWidth + z] = sum;
+			TerrainVertex skirt = vertices[gridIndex];
+			skirt.position[1] -= chunk.skirtDepth;
+			vertices[skirtIndex++] = skirt;
 		}
 	}
+}
+
+// Splits the rows between threads. Each thread's block of rows only reads the
+// heightmap and writes its own rows of mNormals, so they never share anything.
+void Terrain::computeNormals()
+{
+	mNormals = new PackedNormal[mWidth * mLength];
+
+	int threadCount = std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+	threadCount = std::max( 1, std::min( threadCount, mWidth / TERRAIN_MIN_ROWS_PER_THREAD ) );
+	int rowsPerThread = ( mWidth + threadCount - 1 ) / threadCount;
+
+	std::vector<std::thread> threads;
+	for( int startX = rowsPerThread; startX < mWidth; startX += rowsPerThread )
+	{
+		threads.push_back( std::thread( &Terrain::computeNormalRows, this, startX, std::min( startX + rowsPerThread, mWidth ), 0, mLength ) );
+	}
+	computeNormalRows( 0, std::min( rowsPerThread, mWidth ), 0, mLength );
+
+	for( unsigned int i = 0; i < threads.size(); i++ )
+	{
+		threads[i].join();
+	}
+}
+
+// Smoothing a row needs the face normals of the rows on both sides, so they're kept
+// in a sliding window of three rows rather than for the whole map. The window also
+// covers one sample past each end of [startZ, endZ), for the neighbors along z.
+void Terrain::computeNormalRows( int startX, int endX, int startZ, int endZ )
+{
+	int faceStartZ = std::max( startZ - 1, 0 );
+	int faceEndZ = std::min( endZ + 1, mLength );
+	int faceCount = faceEndZ - faceStartZ;
+
+	Vector3fArray rows[3];
+	Vector3fArray zeros( faceCount );    // Stands in for the rows past the edges of the map
+	Vector3fArray scratch( faceCount );
+	Vector3fArray smoothed( endZ - startZ );
+	std::vector<float> heights( 3 * mLength );
+	for( int i = 0; i < 3; i++ )
+	{
+		rows[i].resize( faceCount );
+	}
+
+	Vector3fArray *previous = &rows[0];
+	Vector3fArray *current = &rows[1];
+	Vector3fArray *next = &rows[2];
+	if( startX > 0 )
+	{
+		computeFaceNormalRow( startX - 1, faceStartZ, faceEndZ, &heights[0], *previous, scratch );
+	}
+	computeFaceNormalRow( startX, faceStartZ, faceEndZ, &heights[0], *current, scratch );
 
 	// Average the normals to make the terrain look smoother
-	mNormals = new Vector3f[mWidth * mLength];
 	float dropOffRatio = 0.5f;		// How much of other normals we combine into this one
-	for( int x = 0; x < mWidth; x++ )
+	int last = mLength - 1;
+	int interiorStartZ = std::max( startZ, 1 );
+	int interiorEndZ = std::min( endZ, last );
+	for( int x = startX; x < endX; x++ )
 	{
-		for( int z = 0; z < mLength; z++ )
+		if( x < mWidth - 1 )
 		{
-			Vector3f sum = tempNormals[x * mWidth + z];
+			computeFaceNormalRow( x + 1, faceStartZ, faceEndZ, &heights[0], *next, scratch );
+		}
+		const Vector3fArray & above = x > 0 ? *previous : zeros;
+		const Vector3fArray & below = x < mWidth - 1 ? *next : zeros;
 
-			if( x > 0 )
+		const float *components[3] = { current->x(), current->y(), current->z() };
+		const float *aboveComponents[3] = { above.x(), above.y(), above.z() };
+		const float *belowComponents[3] = { below.x(), below.y(), below.z() };
+		float *smoothedComponents[3] = { smoothed.x(), smoothed.y(), smoothed.z() };
+		for( int axis = 0; axis < 3; axis++ )
+		{
+			// Indexed by z, rather than by position in the window
+			const float *row = components[axis] - faceStartZ;
+			const float *rowAbove = aboveComponents[axis] - faceStartZ;
+			const float *rowBelow = belowComponents[axis] - faceStartZ;
+			float *out = smoothedComponents[axis] - startZ;
+			for( int z = interiorStartZ; z < interiorEndZ; z++ )
+			{
+				out[z] = row[z] + ( row[z - 1] + row[z + 1] + rowAbove[z] + rowBelow[z] ) * dropOffRatio;
+			}
+			if( startZ == 0 )
 			{
-				sum += tempNormals[( x - 1 ) * mWidth + z] * dropOffRatio;
+				out[0] = row[0] + ( ( last > 0 ? row[1] : 0.0f ) + rowAbove[0] + rowBelow[0] ) * dropOffRatio;
 			}
-			if( x < mWidth - 1 )
+			if( endZ == mLength && last > 0 )
 			{
-				sum += tempNormals[( x + 1 ) * mWidth + z] * dropOffRatio;
+				out[last] = row[last] + ( row[last - 1] + rowAbove[last] + rowBelow[last] ) * dropOffRatio;
 			}
-			if( z > 0 )
+		}
+
+		Vector3fArray::normalize( smoothed, smoothed );
+		PackedNormal::pack( smoothed, &mNormals[x * mLength + startZ] );
+
+		Vector3fArray *oldest = previous;
+		previous = current;
+		current = next;
+		next = oldest;
+	}
+}
+
+// Sum of the normals of the four triangles around each sample of row x. With a
+// neighbor one unit away along each axis, each cross product works out to
+// ( a, 1, b ) for height differences a and b, so all that's left to vectorize is
+// normalizing them.
+void Terrain::computeFaceNormalRow( int x, int startZ, int endZ, float * heights, Vector3fArray & faceNormals, Vector3fArray & scratch ) const
+{
+	// Heights one sample past each end are needed too, and are indexed by z
+	int heightStartZ = std::max( startZ - 1, 0 );
+	int heightEndZ = std::min( endZ + 1, mLength );
+	float *rowHeights = heights - heightStartZ;
+	float *previousHeights = x > 0 ? rowHeights + mLength : NULL;
+	float *nextHeights = x < mWidth - 1 ? rowHeights + 2 * mLength : NULL;
+	decodeHeightRow( x, heightStartZ, heightEndZ, rowHeights );
+	if( previousHeights != NULL )
+	{
+		decodeHeightRow( x - 1, heightStartZ, heightEndZ, previousHeights );
+	}
+	if( nextHeights != NULL )
+	{
+		decodeHeightRow( x + 1, heightStartZ, heightEndZ, nextHeights );
+	}
+	int last = mLength - 1;
+	int count = endZ - startZ;
+
+	float *sumX = faceNormals.x();
+	float *sumY = faceNormals.y();
+	float *sumZ = faceNormals.z();
+	for( int i = 0; i < count; i++ )
+	{
+		sumX[i] = 0.0f;
+		sumY[i] = 0.0f;
+		sumZ[i] = 0.0f;
+	}
+
+	float *triangleX = scratch.x();
+	float *triangleY = scratch.y();
+	float *triangleZ = scratch.z();
+
+	// Triangles towards -x or +x, and towards -z then +z. The triangles past the edges of
+	// the map are left out, the same as the samples past them.
+	for( int side = 0; side < 2; side++ )
+	{
+		const float *neighborHeights = side == 0 ? previousHeights : nextHeights;
+		if( neighborHeights == NULL )
+		{
+			continue;
+		}
+		float sign = side == 0 ? 1.0f : -1.0f;
+
+		for( int towardsPositiveZ = 0; towardsPositiveZ < 2; towardsPositiveZ++ )
+		{
+			for( int z = startZ; z < endZ; z++ )
 			{
-				sum += tempNormals[x * mWidth + ( z - 1 )] * dropOffRatio;
+				triangleX[z - startZ] = sign * ( neighborHeights[z] - rowHeights[z] );
+				triangleY[z - startZ] = 1.0f;
 			}
-			if( z < mLength - 1 )
+			// Both work out to the height at z minus the height at z + 1
+			int offset = towardsPositiveZ ? 0 : 1;
+			int firstZ = std::max( startZ, offset );
+			int lastZ = std::min( endZ, last + offset );
+			for( int z = firstZ; z < lastZ; z++ )
 			{
-				sum += tempNormals[x * mWidth + ( z + 1 )] * dropOffRatio;
+				triangleZ[z - startZ] = rowHeights[z - offset] - rowHeights[z + 1 - offset];
 			}
 
-			sum.normalize();
-			mNormals[x * mWidth + z] = sum;
+			int missing = ( towardsPositiveZ ? last : 0 ) - startZ;
+			bool isMissing = missing >= 0 && missing < count;
+			if( isMissing )
+			{
+				triangleZ[missing] = 0.0f;
+			}
+			Vector3fArray::normalize( scratch, scratch );
+			if( isMissing )
+			{
+				triangleX[missing] = 0.0f;
+				triangleY[missing] = 0.0f;
+				triangleZ[missing] = 0.0f;
+			}
+			Vector3fArray::add( faceNormals, scratch, faceNormals );
 		}
 	}
 }
+
+void Terrain::decodeHeightRow( int x, int startZ, int endZ, float * heights ) const
+{
+	const uint16_t *samples = &mHeightMap[x * mLength];
+	for( int z = startZ; z < endZ; z++ )
+	{
+		heights[z] = mHeightOffset + samples[z] * mHeightScale;
+	}
+}
@@ -7,29 +7,181 @@
 
 #include "Math.hpp"
 #include "Texture.hpp"
+#include "Vector3fArray.hpp"
+#include "OrientedBoundingBox.hpp"
+#include "HeightPyramid.hpp"
+#include "Quantize.hpp"
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+// Quads along each edge of a chunk, the unit of culling and level of detail
+#define TERRAIN_CHUNK_SIZE 64
+// Level n skips every 2^n - 1 samples, so level 4 draws a chunk as 4x4 quads
+#define TERRAIN_LOD_LEVELS 5
+// A chunk is drawn at the coarsest level whose error would cover no more than this many pixels
+#define TERRAIN_MAX_SCREEN_ERROR 2.0f
+// Geomorphs are uploaded in this many steps, so a chunk isn't re-uploaded every frame
+#define TERRAIN_MORPH_STEPS 16
+// Fewer rows than this aren't worth starting another thread for
+#define TERRAIN_MIN_ROWS_PER_THREAD 64
+
+// Interleaved layout of the terrain's vertex buffer
+struct TerrainVertex
+{
+	float position[3];
+	float normal[3];
+	float texCoord[2];
+};
+
+// A square piece of the terrain. Its vertices are contiguous in the vertex buffer:
+// the full resolution grid, duplicating the samples on the edges it shares with its
+// neighbors, followed by a skirt hanging down from each of its four edges. The skirts
+// hide the cracks between neighbors drawn at different levels of detail. Every level
+// has its own stitched triangle strip, using every 2^level-th grid sample plus the last.
+struct TerrainChunk
+{
+	Vector3f minCorner;    // Bounding box, from the chunk's min and max heights and its skirts
+	Vector3f maxCorner;
+	int      startX;       // Heightmap samples covered, inclusive
+	int      startZ;
+	int      endX;
+	int      endZ;
+	int      firstVertex;
+	int      vertexCount;
+	float    skirtDepth;
+
+	int      levelCount;    // Only levels whose step fits within the chunk
+	int      firstIndex[TERRAIN_LOD_LEVELS];
+	int      indexCount[TERRAIN_LOD_LEVELS];
+	float    geometricError[TERRAIN_LOD_LEVELS];    // Max height difference from full resolution
+
+	int      level;           // Level currently drawn
+	int      uploadedLevel;   // Level and morph step the vertex buffer holds, -1 if unmorphed
+	int      uploadedMorph;
+};
 
 class Terrain
 {
 	public:
-		Terrain( const std::string & heightmapFilename, const std::string & textureFilename, const float heightScale );    // Heights of terrain will range from -heightScale / 2 to heightScale / 2
+		// Heights of terrain will range from -heightScale / 2 to heightScale / 2. The
+		// heightmap can be any file loadHeightmap() reads, 8 or 16 bits per sample.
+		Terrain( const std::string & heightmapFilename, const std::string & textureFilename, const float heightScale );
 		~Terrain();
 
+		// Draws every chunk
 		void render() const;
-		float getHeight( int x, int z ) const { return mHeightMap[x * mWidth + z]; };
-		Vector3f getNormal( int x, int z ) const { return mNormals[x * mWidth + z]; };
+		// Draws only the chunks whose bounding boxes are inside the frustum, e.g. Camera::getFrustum()
+		void render( const Frustum & frustum ) const;
+		// Indices into the chunks that render( frustum ) would draw
+		void getVisibleChunks( const Frustum & frustum, std::vector<int> & visibleChunks ) const;
+		int getChunkCount() const { return mChunks.size(); };
+		// Picks each visible chunk's level from its screen-space error, as seen from the
+		// frustum's position by a viewport viewportWidth pixels wide, and geomorphs chunks
+		// that are close to switching to a coarser level. Call before render( frustum ).
+		void updateLevelOfDetail( const Frustum & frustum, int viewportWidth );
+		// Triangles in the chunks that would be drawn, including degenerates and skirts
+		int getTriangleCount( const std::vector<int> & chunks ) const;
+		float getHeight( int x, int z ) const { return mHeightOffset + mHeightMap[x * mLength + z] * mHeightScale; };
+		Vector3f getNormal( int x, int z ) const { return mNormals[x * mLength + z].unpack(); };
+		// Height of the drawn surface anywhere on the map, from the same two triangles per
+		// quad as the vertex buffer. Points off the map are clamped to its edges.
+		float sampleHeight( float x, float z ) const;
+		// Normal of the triangle under the point, so it agrees with sampleHeight()'s
+		// slope; getNormal() has the smoothed normals used for lighting
+		Vector3f sampleNormal( float x, float z ) const;
+		// Batch versions, 4 points at a time with SSE2. Only x and z of each position are
+		// read, and out may be positions.y() to snap the positions to the ground.
+		void sampleHeights( const Vector3fArray & positions, float * out ) const;
+		// out must be the same size as positions
+		void sampleNormals( const Vector3fArray & positions, Vector3fArray & out ) const;
+
+		// Contact between the box and the surface, the terrain being the first box of the
+		// manifold, so its normal points up out of the ground. Only the part of the
+		// heightmap under the box's footprint is examined.
+		bool collide( const OrientedBoundingBox & box, ContactManifold & manifold ) const;
+		// Nearest hit of the ray on the surface within maxDistance, which like distance
+		// is measured in lengths of direction
+		bool raycast( const Vector3f & origin, const Vector3f & direction, float maxDistance, float & distance ) const;
+		const HeightPyramid & getHeightPyramid() const { return mHeightPyramid; };
+
+		// Deforms the terrain at runtime, e.g. for craters. modify( x, z, height ) is called
+		// for each sample in [startX, endX] x [startZ, endZ], clipped to the map, and returns
+		// its new height, which is clamped to the range given to the constructor. Only the
+		// normals, height pyramid entries and chunks the rectangle reaches are recomputed.
+		template<typename Modifier>
+		void modifyRegion( int startX, int startZ, int endX, int endZ, Modifier modify );
 
 	private:
-		void buildDisplayList();
+		// Splits the heightmap into chunks and uploads all of their vertices and indices
+		void buildBuffers();
+		// Geometric errors, skirt depth and bounding box, from the chunk's current heights
+		void computeChunkBounds( TerrainChunk & chunk ) const;
+		// Recomputes everything derived from the samples in [startX, endX] x [startZ, endZ]
+		// and re-uploads the chunks they reach, after modifyRegion() has changed them
+		void updateRegion( int startX, int startZ, int endX, int endZ );
+		void buildChunkIndices( const TerrainChunk & chunk, int level, std::vector<unsigned int> & indices ) const;
+		// Height of the given level's triangles at a full resolution sample
+		float getLevelHeight( const TerrainChunk & chunk, int level, int x, int z ) const;
+		// Writes the chunk's vertices, with samples dropped by level + 1 moved morph of the
+		// way towards where that level's triangles put them
+		void fillChunkVertices( const TerrainChunk & chunk, int level, float morph, std::vector<TerrainVertex> & vertices ) const;
+		// Draws the given chunks with a single glMultiDrawElements() call
+		void renderChunks( const std::vector<int> & chunks ) const;
 		void computeNormals();
+		// Normals for [startX, endX) x [startZ, endZ); whole rows are one thread's share of
+		// computeNormals()
+		void computeNormalRows( int startX, int endX, int startZ, int endZ );
+		// Face normals for [startZ, endZ) of row x. heights needs room for three rows,
+		// which it's used to decode.
+		void computeFaceNormalRow( int x, int startZ, int endZ, float * heights, Vector3fArray & faceNormals, Vector3fArray & scratch ) const;
+		void decodeHeightRow( int x, int startZ, int endZ, float * heights ) const;
+		// Visits the children of a pyramid entry the ray passes over in the order it passes
+		// them, skipping those it stays above or below. [enter, exit] is where the ray is over the entry.
+		bool raycastNode( int level, int x, int z, const Vector3f & origin, const Vector3f & direction, float enter, float exit, float & distance ) const;
+		bool raycastQuad( int x, int z, const Vector3f & origin, const Vector3f & direction, float enter, float exit, float & distance ) const;
 
-		float		*mHeightMap;
-		Vector3f	*mNormals;
+		// 6 bytes a sample: raw 16-bit heights, getHeight() applies the scale and offset,
+		// and octahedral normals
+		uint16_t		*mHeightMap;
+		float			mHeightScale;
+		float			mHeightOffset;
+		PackedNormal	*mNormals;
 		int			mWidth;
 		int			mLength;
+		HeightPyramid	mHeightPyramid;
+
+		std::vector<TerrainChunk>	mChunks;
+		unsigned int	mVertexBuffer;
+		unsigned int	mIndexBuffer;
 
-		int			mDisplayListHandle;
+		// Scratch space for the chunks drawn each frame, kept to avoid reallocating
+		mutable std::vector<int>	mVisibleChunks;
 		Texture		*mTexture;
 };
 
+template<typename Modifier>
+void Terrain::modifyRegion( int startX, int startZ, int endX, int endZ, Modifier modify )
+{
+	startX = std::max( startX, 0 );
+	startZ = std::max( startZ, 0 );
+	endX = std::min( endX, mWidth - 1 );
+	endZ = std::min( endZ, mLength - 1 );
+	if( startX > endX || startZ > endZ )
+	{
+		return;
+	}
+
+	for( int x = startX; x <= endX; x++ )
+	{
+		for( int z = startZ; z <= endZ; z++ )
+		{
+			float sample = ( modify( x, z, getHeight( x, z ) ) - mHeightOffset ) / mHeightScale;
+			mHeightMap[x * mLength + z] = static_cast<uint16_t>( std::min( std::max( sample, 0.0f ), 65535.0f ) + 0.5f );
+		}
+	}
+	updateRegion( startX, startZ, endX, endZ );
+}
+
 #endif
@@ -0,0 +1,203 @@
+#include "Vector3fArray.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+// Each component block starts on a 32 byte boundary for AVX
+#define VECTOR3F_ARRAY_ALIGNMENT 32
+
+/***********************************************************
+ * SSE Kernels, always available on x86-64
+ **********************************************************/
+namespace sse
+{
+	typedef __m128 Lane;
+	#define LANE_WIDTH 4
+
+	inline Lane load( const float * source ) { return _mm_loadu_ps( source ); }
+	inline void store( float * destination, Lane value ) { _mm_storeu_ps( destination, value ); }
+	inline Lane splat( float value ) { return _mm_set1_ps( value ); }
+	inline Lane add( Lane a, Lane b ) { return _mm_add_ps( a, b ); }
+	inline Lane sub( Lane a, Lane b ) { return _mm_sub_ps( a, b ); }
+	inline Lane mul( Lane a, Lane b ) { return _mm_mul_ps( a, b ); }
+	inline Lane div( Lane a, Lane b ) { return _mm_div_ps( a, b ); }
+	inline Lane squareRoot( Lane a ) { return _mm_sqrt_ps( a ); }
+
+	#include "Vector3fArrayKernels.inl"
+
+	#undef LANE_WIDTH
+}
+
+/***********************************************************
+ * AVX2 Kernels, only run if the CPU supports them
+ **********************************************************/
+#pragma GCC push_options
+#pragma GCC target( "avx2" )
+namespace avx2
+{
+	typedef __m256 Lane;
+	#define LANE_WIDTH 8
+
+	inline Lane load( const float * source ) { return _mm256_loadu_ps( source ); }
+	inline void store( float * destination, Lane value ) { _mm256_storeu_ps( destination, value ); }
+	inline Lane splat( float value ) { return _mm256_set1_ps( value ); }
+	inline Lane add( Lane a, Lane b ) { return _mm256_add_ps( a, b ); }
+	inline Lane sub( Lane a, Lane b ) { return _mm256_sub_ps( a, b ); }
+	inline Lane mul( Lane a, Lane b ) { return _mm256_mul_ps( a, b ); }
+	inline Lane div( Lane a, Lane b ) { return _mm256_div_ps( a, b ); }
+	inline Lane squareRoot( Lane a ) { return _mm256_sqrt_ps( a ); }
+
+	#include "Vector3fArrayKernels.inl"
+
+	#undef LANE_WIDTH
+}
+#pragma GCC pop_options
+
+static bool detectAvx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx2" );
+}
+
+static const bool gUseAvx2 = detectAvx2();
+
+/***********************************************************
+ * Vector3fArray Class Methods
+ **********************************************************/
+Vector3fArray::Vector3fArray() :
+	mSize( 0 ),
+	mX( NULL ),
+	mY( NULL ),
+	mZ( NULL )
+{
+}
+
+Vector3fArray::Vector3fArray( int size ) :
+	mSize( 0 ),
+	mX( NULL ),
+	mY( NULL ),
+	mZ( NULL )
+{
+	allocate( size );
+}
+
+Vector3fArray::Vector3fArray( const Vector3f * vectors, int count ) :
+	mSize( 0 ),
+	mX( NULL ),
+	mY( NULL ),
+	mZ( NULL )
+{
+	allocate( count );
+	for( int i = 0; i < count; i++ )
+	{
+		set( i, vectors[i] );
+	}
+}
+
+Vector3fArray::~Vector3fArray()
+{
+	deallocate();
+}
+
+void Vector3fArray::resize( int size )
+{
+	deallocate();
+	allocate( size );
+}
+
+void Vector3fArray::allocate( int size )
+{
+	mSize = size;
+	if( size <= 0 )
+	{
+		return;
+	}
+
+	// One allocation for all three components, each padded out to the alignment
+	int floatsPerBlock = VECTOR3F_ARRAY_ALIGNMENT / sizeof( float );
+	int paddedSize = ( ( size + floatsPerBlock - 1 ) / floatsPerBlock ) * floatsPerBlock;
+	void * storage = NULL;
+	if( posix_memalign( &storage, VECTOR3F_ARRAY_ALIGNMENT, 3 * paddedSize * sizeof( float ) ) != 0 )
+	{
+		storage = NULL;
+		mSize = 0;
+		return;
+	}
+	memset( storage, 0, 3 * paddedSize * sizeof( float ) );
+
+	mX = static_cast<float *>( storage );
+	mY = mX + paddedSize;
+	mZ = mY + paddedSize;
+}
+
+void Vector3fArray::deallocate()
+{
+	free( mX );
+	mX = NULL;
+	mY = NULL;
+	mZ = NULL;
+	mSize = 0;
+}
+
+void Vector3fArray::add( const Vector3fArray & a, const Vector3fArray & b, Vector3fArray & out )
+{
+	if( gUseAvx2 )
+	{
+		avx2::addKernel( a.mX, b.mX, out.mX, a.mSize );
+		avx2::addKernel( a.mY, b.mY, out.mY, a.mSize );
+		avx2::addKernel( a.mZ, b.mZ, out.mZ, a.mSize );
+	}
+	else
+	{
+		sse::addKernel( a.mX, b.mX, out.mX, a.mSize );
+		sse::addKernel( a.mY, b.mY, out.mY, a.mSize );
+		sse::addKernel( a.mZ, b.mZ, out.mZ, a.mSize );
+	}
+}
+
+void Vector3fArray::scale( const Vector3fArray & a, float scale, Vector3fArray & out )
+{
+	if( gUseAvx2 )
+	{
+		avx2::scaleKernel( a.mX, scale, out.mX, a.mSize );
+		avx2::scaleKernel( a.mY, scale, out.mY, a.mSize );
+		avx2::scaleKernel( a.mZ, scale, out.mZ, a.mSize );
+	}
+	else
+	{
+		sse::scaleKernel( a.mX, scale, out.mX, a.mSize );
+		sse::scaleKernel( a.mY, scale, out.mY, a.mSize );
+		sse::scaleKernel( a.mZ, scale, out.mZ, a.mSize );
+	}
+}
+
+void Vector3fArray::dot( const Vector3fArray & a, const Vector3fArray & b, float * out )
+{
+	gUseAvx2 ? avx2::dotKernel( a, b, out ) : sse::dotKernel( a, b, out );
+}
+
+void Vector3fArray::cross( const Vector3fArray & a, const Vector3fArray & b, Vector3fArray & out )
+{
+	gUseAvx2 ? avx2::crossKernel( a, b, out ) : sse::crossKernel( a, b, out );
+}
+
+void Vector3fArray::normalize( const Vector3fArray & a, Vector3fArray & out )
+{
+	gUseAvx2 ? avx2::normalizeKernel( a, out ) : sse::normalizeKernel( a, out );
+}
+
+void Vector3fArray::rotate( const Quaternion & rotation, const Vector3fArray & a, Vector3fArray & out )
+{
+	Matrix3f matrix( rotation );
+	gUseAvx2 ? avx2::rotateKernel( matrix, a, out ) : sse::rotateKernel( matrix, a, out );
+}
+
+void Vector3fArray::planeDistance( const Plane & plane, const Vector3fArray & a, float * out )
+{
+	gUseAvx2 ? avx2::planeDistanceKernel( plane, a, out ) : sse::planeDistanceKernel( plane, a, out );
+}
+
+bool Vector3fArray::isUsingAvx2()
+{
+	return gUseAvx2;
+}
@@ -0,0 +1,62 @@
+#ifndef VECTOR3F_ARRAY_HPP
+#define VECTOR3F_ARRAY_HPP
+
+#include "Math.hpp"
+
+// Structure-of-arrays storage for many Vector3f's: all x components, then all y,
+// then all z, each in its own 32 byte aligned block. Lets the batch kernels below
+// work on 4 (SSE) or 8 (AVX2) vectors per instruction. AVX2 is used if the CPU
+// running the program supports it, which is checked once at startup.
+class Vector3fArray
+{
+	public:
+		Vector3fArray();
+		explicit Vector3fArray( int size );    // Zero-initialized
+		Vector3fArray( const Vector3f * vectors, int count );
+		~Vector3fArray();
+
+		int size() const { return mSize; };
+		// Contents are lost, new elements are zero-initialized
+		void resize( int size );
+
+		Vector3f get( int index ) const { return Vector3f( mX[index], mY[index], mZ[index] ); };
+		void set( int index, const Vector3f & vector ) { mX[index] = vector[0]; mY[index] = vector[1]; mZ[index] = vector[2]; };
+
+		// Raw component arrays, for filling the array directly
+		float * x() { return mX; };
+		float * y() { return mY; };
+		float * z() { return mZ; };
+		const float * x() const { return mX; };
+		const float * y() const { return mY; };
+		const float * z() const { return mZ; };
+
+		// Batch kernels. Every array must have the same size, and the output
+		// may be the same array as one of the inputs.
+		static void add( const Vector3fArray & a, const Vector3fArray & b, Vector3fArray & out );
+		static void scale( const Vector3fArray & a, float scale, Vector3fArray & out );
+		static void dot( const Vector3fArray & a, const Vector3fArray & b, float * out );
+		static void cross( const Vector3fArray & a, const Vector3fArray & b, Vector3fArray & out );
+		static void normalize( const Vector3fArray & a, Vector3fArray & out );
+		// Length preserving, same as Quaternion::rotate()
+		static void rotate( const Quaternion & rotation, const Vector3fArray & a, Vector3fArray & out );
+		// Signed distance of each point from the plane, same as Plane::distanceTo()
+		static void planeDistance( const Plane & plane, const Vector3fArray & a, float * out );
+
+		// True if the kernels are running the AVX2 versions
+		static bool isUsingAvx2();
+
+	private:
+		// Owns its storage, so no copying
+		Vector3fArray( const Vector3fArray & );
+		Vector3fArray & operator=( const Vector3fArray & );
+
+		void allocate( int size );
+		void deallocate();
+
+		int     mSize;
+		float * mX;
+		float * mY;
+		float * mZ;
+};
+
+#endif
@@ -0,0 +1,179 @@
+// Batch kernels for Vector3fArray, written once for every instruction set.
+// Vector3fArray.cpp includes this file once per instruction set, inside its own
+// namespace, after defining Lane, LANE_WIDTH and these helpers:
+//   Lane load( const float * )          void store( float *, Lane )
+//   Lane splat( float )                 Lane add/sub/mul/div( Lane, Lane )
+//   Lane squareRoot( Lane )
+// Each kernel does as many full lanes as it can, then finishes the tail with
+// scalar code. All inputs of one chunk are loaded before any output is stored, so
+// the output may alias the inputs.
+
+static void addKernel( const float * a, const float * b, float * out, int count )
+{
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		store( out + i, add( load( a + i ), load( b + i ) ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = a[i] + b[i];
+	}
+}
+
+static void scaleKernel( const float * a, float scale, float * out, int count )
+{
+	Lane scaleLane = splat( scale );
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		store( out + i, mul( load( a + i ), scaleLane ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = a[i] * scale;
+	}
+}
+
+static void dotKernel( const Vector3fArray & a, const Vector3fArray & b, float * out )
+{
+	const float * ax = a.x();
+	const float * ay = a.y();
+	const float * az = a.z();
+	const float * bx = b.x();
+	const float * by = b.y();
+	const float * bz = b.z();
+	int count = a.size();
+
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		Lane result = add( add( mul( load( ax + i ), load( bx + i ) ), mul( load( ay + i ), load( by + i ) ) ), mul( load( az + i ), load( bz + i ) ) );
+		store( out + i, result );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+	}
+}
+
+static void crossKernel( const Vector3fArray & a, const Vector3fArray & b, Vector3fArray & out )
+{
+	const float * ax = a.x();
+	const float * ay = a.y();
+	const float * az = a.z();
+	const float * bx = b.x();
+	const float * by = b.y();
+	const float * bz = b.z();
+	float * ox = out.x();
+	float * oy = out.y();
+	float * oz = out.z();
+	int count = a.size();
+
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		Lane x1 = load( ax + i );
+		Lane y1 = load( ay + i );
+		Lane z1 = load( az + i );
+		Lane x2 = load( bx + i );
+		Lane y2 = load( by + i );
+		Lane z2 = load( bz + i );
+		store( ox + i, sub( mul( y1, z2 ), mul( z1, y2 ) ) );
+		store( oy + i, sub( mul( z1, x2 ), mul( x1, z2 ) ) );
+		store( oz + i, sub( mul( x1, y2 ), mul( y1, x2 ) ) );
+	}
+	for( ; i < count; i++ )
+	{
+		Vector3f result = a.get( i ).cross( b.get( i ) );
+		out.set( i, result );
+	}
+}
+
+static void normalizeKernel( const Vector3fArray & a, Vector3fArray & out )
+{
+	const float * ax = a.x();
+	const float * ay = a.y();
+	const float * az = a.z();
+	float * ox = out.x();
+	float * oy = out.y();
+	float * oz = out.z();
+	int count = a.size();
+
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		Lane x = load( ax + i );
+		Lane y = load( ay + i );
+		Lane z = load( az + i );
+		Lane magnitude = squareRoot( add( add( mul( x, x ), mul( y, y ) ), mul( z, z ) ) );
+		store( ox + i, div( x, magnitude ) );
+		store( oy + i, div( y, magnitude ) );
+		store( oz + i, div( z, magnitude ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out.set( i, a.get( i ).normalize() );
+	}
+}
+
+// The quaternion is turned into a rotation matrix once, so each vector costs 9 multiplies
+static void rotateKernel( const Matrix3f & rotation, const Vector3fArray & a, Vector3fArray & out )
+{
+	const float * ax = a.x();
+	const float * ay = a.y();
+	const float * az = a.z();
+	float * ox = out.x();
+	float * oy = out.y();
+	float * oz = out.z();
+	int count = a.size();
+
+	Lane m[3][3];
+	for( int row = 0; row < 3; row++ )
+	{
+		for( int column = 0; column < 3; column++ )
+		{
+			m[row][column] = splat( rotation( row, column ) );
+		}
+	}
+
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		Lane x = load( ax + i );
+		Lane y = load( ay + i );
+		Lane z = load( az + i );
+		store( ox + i, add( add( mul( m[0][0], x ), mul( m[0][1], y ) ), mul( m[0][2], z ) ) );
+		store( oy + i, add( add( mul( m[1][0], x ), mul( m[1][1], y ) ), mul( m[1][2], z ) ) );
+		store( oz + i, add( add( mul( m[2][0], x ), mul( m[2][1], y ) ), mul( m[2][2], z ) ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out.set( i, rotation * a.get( i ) );
+	}
+}
+
+static void planeDistanceKernel( const Plane & plane, const Vector3fArray & a, float * out )
+{
+	const float * ax = a.x();
+	const float * ay = a.y();
+	const float * az = a.z();
+	int count = a.size();
+
+	Vector3f normal = plane.getNormal();
+	Lane nx = splat( normal[0] );
+	Lane ny = splat( normal[1] );
+	Lane nz = splat( normal[2] );
+	Lane constant = splat( plane.getConstant() );
+
+	int i = 0;
+	for( ; i + LANE_WIDTH <= count; i += LANE_WIDTH )
+	{
+		Lane distance = add( add( mul( nx, load( ax + i ) ), mul( ny, load( ay + i ) ) ), mul( nz, load( az + i ) ) );
+		store( out + i, sub( distance, constant ) );
+	}
+	for( ; i < count; i++ )
+	{
+		out[i] = plane.distanceTo( a.get( i ) );
+	}
+}
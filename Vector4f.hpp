@@ -0,0 +1,123 @@
+#ifndef VECTOR4F_HPP
+#define VECTOR4F_HPP
+
+#include "Math.hpp"
+
+#if defined( __SSE__ )
+	#include <xmmintrin.h>
+	#define VECTOR4F_USE_SSE 1
+#else
+	#define VECTOR4F_USE_SSE 0
+#endif
+
+// 16 byte aligned vector for hot loops, backed by an SSE register when the compiler
+// targets SSE and plain floats otherwise. A Vector3f converts to one padded with w = 0,
+// and since w stays 0 through every operation below, dot(), magnitude() and friends
+// give the same results as the Vector3f versions.
+class Vector4f
+{
+	public:
+		Vector4f() { set( 0.0f, 0.0f, 0.0f, 0.0f ); };
+		Vector4f( float x, float y, float z, float w = 0.0f ) { set( x, y, z, w ); };
+		explicit Vector4f( const Vector3f & vector ) { set( vector[0], vector[1], vector[2], 0.0f ); };
+
+		Vector3f toVector3f() const { return Vector3f( mComponents[0], mComponents[1], mComponents[2] ); };
+
+		// Same access as Vector3f, so existing callers using [] keep working
+		float & operator[]( int index ) { return mComponents[index]; };
+		float operator[]( int index ) const { return mComponents[index]; };
+
+#if VECTOR4F_USE_SSE
+		Vector4f operator*( float scale ) const { return Vector4f( _mm_mul_ps( mRegister, _mm_set1_ps( scale ) ) ); };
+		Vector4f operator/( float scale ) const { return Vector4f( _mm_div_ps( mRegister, _mm_set1_ps( scale ) ) ); };
+		Vector4f operator+( const Vector4f & rhs ) const { return Vector4f( _mm_add_ps( mRegister, rhs.mRegister ) ); };
+		Vector4f operator-( const Vector4f & rhs ) const { return Vector4f( _mm_sub_ps( mRegister, rhs.mRegister ) ); };
+		Vector4f operator-() const { return Vector4f( _mm_sub_ps( _mm_setzero_ps(), mRegister ) ); };
+
+		const Vector4f & operator*=( float scale ) { mRegister = _mm_mul_ps( mRegister, _mm_set1_ps( scale ) ); return *this; };
+		const Vector4f & operator/=( float scale ) { mRegister = _mm_div_ps( mRegister, _mm_set1_ps( scale ) ); return *this; };
+		const Vector4f & operator+=( const Vector4f & rhs ) { mRegister = _mm_add_ps( mRegister, rhs.mRegister ); return *this; };
+		const Vector4f & operator-=( const Vector4f & rhs ) { mRegister = _mm_sub_ps( mRegister, rhs.mRegister ); return *this; };
+
+		float dot( const Vector4f & rhs ) const { return _mm_cvtss_f32( dotSplat( mRegister, rhs.mRegister ) ); };
+		// a.yzx * b.zxy - a.zxy * b.yzx, w comes out as 0
+		Vector4f cross( const Vector4f & rhs ) const
+		{
+			__m128 thisYzx = _mm_shuffle_ps( mRegister, mRegister, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+			__m128 thisZxy = _mm_shuffle_ps( mRegister, mRegister, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+			__m128 rhsYzx = _mm_shuffle_ps( rhs.mRegister, rhs.mRegister, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+			__m128 rhsZxy = _mm_shuffle_ps( rhs.mRegister, rhs.mRegister, _MM_SHUFFLE( 3, 1, 0, 2 ) );
+			return Vector4f( _mm_sub_ps( _mm_mul_ps( thisYzx, rhsZxy ), _mm_mul_ps( thisZxy, rhsYzx ) ) );
+		};
+
+		float magnitude() const { return _mm_cvtss_f32( _mm_sqrt_ss( dotSplat( mRegister, mRegister ) ) ); };
+		Vector4f normalize() const { return Vector4f( _mm_div_ps( mRegister, _mm_sqrt_ps( dotSplat( mRegister, mRegister ) ) ) ); };
+		// rsqrt estimate refined with one Newton-Raphson step, about 22 bits of precision
+		// instead of the 12 the estimate alone gives. No sqrt or divide.
+		Vector4f normalizeFast() const
+		{
+			__m128 magnitudeSquared = dotSplat( mRegister, mRegister );
+			__m128 estimate = _mm_rsqrt_ps( magnitudeSquared );
+			__m128 refined = _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), estimate ),
+			                             _mm_sub_ps( _mm_set1_ps( 3.0f ), _mm_mul_ps( _mm_mul_ps( magnitudeSquared, estimate ), estimate ) ) );
+			return Vector4f( _mm_mul_ps( mRegister, refined ) );
+		};
+
+		// Component-wise
+		static Vector4f min( const Vector4f & a, const Vector4f & b ) { return Vector4f( _mm_min_ps( a.mRegister, b.mRegister ) ); };
+		static Vector4f max( const Vector4f & a, const Vector4f & b ) { return Vector4f( _mm_max_ps( a.mRegister, b.mRegister ) ); };
+
+	private:
+		explicit Vector4f( __m128 value ) : mRegister( value ) {};
+
+		void set( float x, float y, float z, float w ) { mRegister = _mm_set_ps( w, z, y, x ); };
+
+		// Dot product in every lane, SSE1 only so no _mm_dp_ps
+		static __m128 dotSplat( __m128 a, __m128 b )
+		{
+			__m128 products = _mm_mul_ps( a, b );
+			__m128 sums = _mm_add_ps( products, _mm_shuffle_ps( products, products, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			return _mm_add_ps( sums, _mm_shuffle_ps( sums, sums, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		};
+
+		union
+		{
+			__m128 mRegister;
+			float  mComponents[4];
+		};
+#else
+		Vector4f operator*( float scale ) const { return Vector4f( mComponents[0] * scale, mComponents[1] * scale, mComponents[2] * scale, mComponents[3] * scale ); };
+		Vector4f operator/( float scale ) const { return Vector4f( mComponents[0] / scale, mComponents[1] / scale, mComponents[2] / scale, mComponents[3] / scale ); };
+		Vector4f operator+( const Vector4f & rhs ) const { return Vector4f( mComponents[0] + rhs.mComponents[0], mComponents[1] + rhs.mComponents[1], mComponents[2] + rhs.mComponents[2], mComponents[3] + rhs.mComponents[3] ); };
+		Vector4f operator-( const Vector4f & rhs ) const { return Vector4f( mComponents[0] - rhs.mComponents[0], mComponents[1] - rhs.mComponents[1], mComponents[2] - rhs.mComponents[2], mComponents[3] - rhs.mComponents[3] ); };
+		Vector4f operator-() const { return Vector4f( -mComponents[0], -mComponents[1], -mComponents[2], -mComponents[3] ); };
+
+		const Vector4f & operator*=( float scale ) { *this = *this * scale; return *this; };
+		const Vector4f & operator/=( float scale ) { *this = *this / scale; return *this; };
+		const Vector4f & operator+=( const Vector4f & rhs ) { *this = *this + rhs; return *this; };
+		const Vector4f & operator-=( const Vector4f & rhs ) { *this = *this - rhs; return *this; };
+
+		float dot( const Vector4f & rhs ) const { return mComponents[0] * rhs.mComponents[0] + mComponents[1] * rhs.mComponents[1] + mComponents[2] * rhs.mComponents[2] + mComponents[3] * rhs.mComponents[3]; };
+		Vector4f cross( const Vector4f & rhs ) const { return Vector4f( mComponents[1] * rhs.mComponents[2] - mComponents[2] * rhs.mComponents[1], mComponents[2] * rhs.mComponents[0] - mComponents[0] * rhs.mComponents[2], mComponents[0] * rhs.mComponents[1] - mComponents[1] * rhs.mComponents[0], 0.0f ); };
+
+		float magnitude() const { return sqrt( this->dot( *this ) ); };
+		Vector4f normalize() const { return *this / this->magnitude(); };
+		// No rsqrt estimate without SSE, so the fast version is the same as normalize()
+		Vector4f normalizeFast() const { return this->normalize(); };
+
+		static Vector4f min( const Vector4f & a, const Vector4f & b ) { return Vector4f( a[0] < b[0] ? a[0] : b[0], a[1] < b[1] ? a[1] : b[1], a[2] < b[2] ? a[2] : b[2], a[3] < b[3] ? a[3] : b[3] ); };
+		static Vector4f max( const Vector4f & a, const Vector4f & b ) { return Vector4f( a[0] > b[0] ? a[0] : b[0], a[1] > b[1] ? a[1] : b[1], a[2] > b[2] ? a[2] : b[2], a[3] > b[3] ? a[3] : b[3] ); };
+
+	private:
+		void set( float x, float y, float z, float w ) { mComponents[0] = x; mComponents[1] = y; mComponents[2] = z; mComponents[3] = w; };
+
+		float mComponents[4] __attribute__( ( aligned( 16 ) ) );
+#endif
+
+	public:
+		float magnitudeSquared() const { return this->dot( *this ); };
+
+		friend std::ostream &operator<<( std::ostream & os, const Vector4f & vector ) { os << '(' << vector[0] << ", " << vector[1] << ", " << vector[2] << ", " << vector[3] << ')'; return os; };
+};
+
+#endif
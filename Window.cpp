@@ -38,12 +38,17 @@ void Window::beginRendering()
 	glutMainLoop();
 }
 
-bool Window::getEvent( Event & event ) const
+bool Window::getEvent( Event & event )
 {
 	if( !eventQueue.empty() )
 	{
 		event = eventQueue.front();
 		eventQueue.pop();
+		if( event.type == WINDOW_RESIZED )
+		{
+			mWidth = event.windowWidth;
+			mHeight = event.windowHeight;
+		}
 		return true;
 	}
 	else
@@ -65,9 +70,15 @@ void Window::init3dRenderMode()
 void Window::handleResize( int width, int height )
 {
 	glViewport( 0, 0, width, height );
-	glMatrixMode( GL_PROJECTION );
-	glLoadIdentity();
-	gluPerspective( 45.0, (float)width / (float)height, 1.0, 1000.0 );
+
+	Event event;
+	memset( &event, 0, sizeof( Event ) );
+
+	event.type = WINDOW_RESIZED;
+	event.windowWidth = width;
+	event.windowHeight = height;
+
+	eventQueue.push( event );
 }
 
 void Window::handleKeyDown( unsigned char key, int x, int y )
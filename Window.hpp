@@ -12,14 +12,17 @@ class Window
 		Window( unsigned int width, unsigned int height, const std::string & title );
 		~Window();
 
-		bool getEvent( Event & event ) const;
+		// Also keeps getWidth() and getHeight() up to date as WINDOW_RESIZED events are taken
+		bool getEvent( Event & event );
 		void beginRendering();
 
 		int getWidth() const { return mWidth; };
 		int getHeight() const { return mHeight; };
 
 	private:
-		// GLUT callback functions for handling events
+		// GLUT callback functions for handling events. Resizing only sets the viewport;
+		// the projection is left to whoever handles the WINDOW_RESIZED event, so it can
+		// come from the same place as the camera's culling frustum.
 		static void handleResize( int width, int height );
 		static void handleKeyDown( unsigned char key, int x, int y );
 		static void handleKeyUp( unsigned char key, int x, int y );
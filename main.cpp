@@ -9,12 +9,18 @@
 #include <cmath>
 #include <stdlib.h>
 #include <cstdlib>
+#include <algorithm>
 #include "GL/glut.h"
 using namespace std;
 
 #include <iostream>
 #include <stdlib.h>
 
+// Projection shared by GL and the camera's culling frustum
+#define FIELD_OF_VIEW 45.0f
+#define NEAR_CLIP 1.0f
+#define FAR_CLIP 1000.0f
+
 bool keyState[256] = { false };
 Terrain *_myTerrain;
 Camera *_myCamera;
@@ -22,6 +28,16 @@ Window *_myWindow;
 Sound *_mySound;
 Vector3f *_sourcePos;
 
+// Sets the GL projection and the frustum used for culling and level of detail together,
+// so they always agree on the aspect ratio
+void setProjection( int width, int height )
+{
+	glMatrixMode( GL_PROJECTION );
+	glLoadIdentity();
+	_myCamera->perspective( FIELD_OF_VIEW, (float)width / (float)std::max( height, 1 ), NEAR_CLIP, FAR_CLIP );
+	glMatrixMode( GL_MODELVIEW );
+}
+
 void handleEvents()
 {
 	Event event;
@@ -43,6 +59,10 @@ void handleEvents()
 		{
 			keyState[event.keyData.keyCode] = false;
 		}
+		else if( event.type == WINDOW_RESIZED )
+		{
+			setProjection( event.windowWidth, event.windowHeight );
+		}
 	}
 
 	if( keyState['g'] )
@@ -105,7 +125,9 @@ void Window::renderScene()
 
 	handleEvents();
 	_myCamera->look();
-	_myTerrain->render();
+	Frustum frustum = _myCamera->getFrustum();
+	_myTerrain->updateLevelOfDetail( frustum, _myWindow->getWidth() );
+	_myTerrain->render( frustum );
 	
 	glutSwapBuffers();
 }
@@ -114,6 +136,8 @@ int main( int argc, char** argv )
 {
 	_myWindow = new Window( 400, 400, "Terrain with Textures" );
 	_myCamera = new Camera( Vector3f( 200, 0, 200 ), 0.0f, 0.0f );
+	// Until the window's first WINDOW_RESIZED event arrives
+	setProjection( _myWindow->getWidth(), _myWindow->getHeight() );
 	_myTerrain = new Terrain( "resources/terrainmap.bmp", "resources/terrain_texture.bmp", 50 );
 	_mySound = new Sound( "resources/British Beercan, Jamaican Bacon.wav" );
 	_sourcePos = new Vector3f( 0, 0, 0 );